@@ -1,144 +1,123 @@
-#include "BezierCurveEvaluator.h"
+#include "Beziercurveevaluator.h"
 #include <assert.h>
 #include "mat.h"
 #include "vec.h"
-#include "modelerapp.h"
 
-#define SEGMENT 30
+#include <algorithm>
 
-bool flatEnough(const Vec4d& px, const Vec4d& py) ;
-void displayBezier(std::vector<Point>& ptvEvaluatedCurvePts, const Vec4d& px, const Vec4d& py) ;
+static const Mat4d s_basis(
+	-1, 3, -3, 1,
+	3, -6, 3, 0,
+	-3, 3, 0, 0,
+	1, 0, 0, 0);
 
-void BezierCurveEvaluator::evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-										 std::vector<Point>& ptvEvaluatedCurvePts, 
-										 const float& fAniLength, 
-										 const bool& bWrap,
-										 const bool& bAdaptive,
-										 const double& dTension) const
+// Control points go in groups of four sharing their ends: 0-3, 3-6
+// and so on.  With wrapping on, the first point comes round again
+// after the last.  Points left over after the last group are joined
+// by lines, which follow the groups in the pieces.
+static int groupCount(const int iCtrlPtCount, const bool bWrap)
 {
-	ptvEvaluatedCurvePts.clear();
-
-	// Wrapping version remark:
-	// we insert one value at the end of the animation coordinate
-	// case1: if this node can be part of the 4-node group (to generate curve)
-	//		  the intersection y-value will determined by two close point in the curve
-	// case2: then we will determine the intersection by using linear interpolation
+	int iCount = iCtrlPtCount + (bWrap ? 1 : 0);
+	return iCount >= 4 ? (iCount - 1) / 3 : 0;
+}
 
-	std::vector<Point> controlPointsCopy(ptvCtrlPts);
-	if (bWrap)
-	{
-		controlPointsCopy.push_back(Point(ptvCtrlPts.front().x + fAniLength,
-			ptvCtrlPts.front().y));
-	}
+static Point groupPoint(const std::vector<Point>& ptvCtrlPts, const int i, const float fAniLength)
+{
+	if (i < (int)ptvCtrlPts.size())
+		return ptvCtrlPts[i];
+	return Point(ptvCtrlPts.front().x + fAniLength, ptvCtrlPts.front().y);
+}
 
-	float x_start = 0.0;
-	float y_start = ptvCtrlPts[0].y;
+// where the line from the last control point to the first, wrapped,
+// crosses the ends of the animation
+static float wrapValue(const std::vector<Point>& ptvCtrlPts, const float fAniLength)
+{
+	const float interval_length = ptvCtrlPts.front().x + fAniLength - ptvCtrlPts.back().x;
+	const float percent = 1.0f - ptvCtrlPts.front().x / interval_length;
+	return ptvCtrlPts.back().y + (ptvCtrlPts.front().y - ptvCtrlPts.back().y) * percent;
+}
 
-	size_t cnt;
-	const Mat4d basis(
-		-1, 3, -3, 1,
-		3, -6, 3, 0,
-		-3, 3, 0, 0,
-		1, 0, 0, 0);
+int BezierCurveEvaluator::pieceCount(const std::vector<Point>& ptvCtrlPts,
+									 const bool& bWrap) const
+{
+	int iGroups = groupCount(ptvCtrlPts.size(), bWrap);
+	return iGroups + std::max((int)ptvCtrlPts.size() - 1 - 3 * iGroups, 0);
+}
 
-	bool is_wrapped = false;
+void BezierCurveEvaluator::evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+										  std::vector<CurveSegment>& pieces,
+										  const int iFirst,
+										  const int iLast,
+										  const float& fAniLength,
+										  const bool& bWrap,
+										  const double& dTension) const
+{
+	int iGroups = groupCount(ptvCtrlPts.size(), bWrap);
 
-	for (cnt = 0; cnt + 3 < controlPointsCopy.size(); cnt += 3)
+	for (int i = iFirst; i <= iLast; ++i)
 	{
-		// push starting and ending points first
-		ptvEvaluatedCurvePts.push_back(controlPointsCopy[cnt]);
-		ptvEvaluatedCurvePts.push_back(controlPointsCopy[cnt + 3]);
-		const Vec4d px(controlPointsCopy[cnt].x, controlPointsCopy[cnt + 1].x,
-			controlPointsCopy[cnt + 2].x, controlPointsCopy[cnt + 3].x);
-		const Vec4d py(controlPointsCopy[cnt].y, controlPointsCopy[cnt + 1].y,
-			controlPointsCopy[cnt + 2].y, controlPointsCopy[cnt + 3].y);
-
-		if (bAdaptive)
+		if (i < iGroups)
 		{
-			displayBezier(ptvEvaluatedCurvePts, px, py);
+			Point p[4];
+			for (int j = 0; j < 4; ++j)
+				p[j] = groupPoint(ptvCtrlPts, 3 * i + j, fAniLength);
+
+			const Vec4d px(p[0].x, p[1].x, p[2].x, p[3].x);
+			const Vec4d py(p[0].y, p[1].y, p[2].y, p[3].y);
+			pieces[i].setCubic(s_basis * px, s_basis * py);
 		}
 		else
-		{		
-			for (int i = 0; i < SEGMENT; ++i)
-			{
-				const double t = i / (double)SEGMENT;
-				const Vec4d param_time(t*t*t, t*t, t, 1);
-				Point eval_point(param_time*basis*px, param_time*basis*py);
-
-				if (eval_point.x > fAniLength && bWrap)
-				{
-					const float x_mod = fmod(eval_point.x, fAniLength);
-					if (!is_wrapped)
-					{
-						const Point prev_point(ptvEvaluatedCurvePts.back());
-						const float x_neg1 = prev_point.x - fAniLength;
-						// push fake starting
-						ptvEvaluatedCurvePts.push_back(Point(x_neg1, prev_point.y));
-						// push fake ending, eval_point.x > fAniLength
-						ptvEvaluatedCurvePts.push_back(eval_point);
-						is_wrapped = true;
-					}
-					eval_point.x = x_mod;
-				}
-				ptvEvaluatedCurvePts.push_back(eval_point);
-			}
-		}				
-	}
-
-	printf("EvaluatePts:%d\n", ptvEvaluatedCurvePts.size() );
-	for (; cnt < ptvCtrlPts.size(); cnt++)
-	{
-		ptvEvaluatedCurvePts.push_back(ptvCtrlPts[cnt]);
-	}
-
-	if (!bWrap)
-	{
-		ptvEvaluatedCurvePts.push_back(Point(0, ptvCtrlPts.front().y));
-		ptvEvaluatedCurvePts.push_back(Point(fAniLength, ptvCtrlPts.back().y));
-	}
-	else if (!is_wrapped)
-	{
-		const float interval_length = ptvCtrlPts.front().x + fAniLength - ptvCtrlPts.back().x;
-		const float percent = 1.0f - ptvCtrlPts.front().x / interval_length;
-		const float y = ptvCtrlPts.back().y + (ptvCtrlPts.front().y - ptvCtrlPts.back().y) * percent;
-		ptvEvaluatedCurvePts.push_back(Point(fAniLength, y));
-		ptvEvaluatedCurvePts.push_back(Point(0.0f, y));
+		{
+			int iCtrlPt = 3 * iGroups + (i - iGroups);
+			pieces[i].setLine(ptvCtrlPts[iCtrlPt], ptvCtrlPts[iCtrlPt + 1]);
+		}
 	}
 }
 
-bool flatEnough(const Vec4d& px, const Vec4d& py)
+void BezierCurveEvaluator::affectedPieces(const std::vector<Point>& ptvCtrlPts,
+										  const int iFirstCtrlPt,
+										  const int iLastCtrlPt,
+										  const bool& bWrap,
+										  int& iFirst,
+										  int& iLast) const
 {
-	Point V[4];
-	for (int i = 0; i < 4; ++i)
+	int iCtrlPtCount = ptvCtrlPts.size();
+	int iGroups = groupCount(iCtrlPtCount, bWrap);
+	int iPieces = pieceCount(ptvCtrlPts, bWrap);
+
+	// the last group ends on the first point, wrapped
+	if (bWrap && iFirstCtrlPt == 0 && 3 * iGroups == iCtrlPtCount)
 	{
-		V[i] = Point(px[i], py[i]);
+		iFirst = 0;
+		iLast = iPieces - 1;
+		return;
 	}
-	return ((V[0].distance(V[1]) + V[1].distance(V[2]) + V[2].distance(V[3]))/V[0].distance(V[3]) < (1 + CurveEvaluator::s_fFlatnessEpsilon));
+
+	// a point shared by two groups (or a group and a line) is in both
+	int k = iFirstCtrlPt;
+	iFirst = (k <= 3 * iGroups) ? std::max((k - 1) / 3, 0) : iGroups + (k - 3 * iGroups - 1);
+	k = iLastCtrlPt;
+	iLast = (k < 3 * iGroups) ? k / 3 : iGroups + (k - 3 * iGroups);
+
+	iFirst = std::max(iFirst, 0);
+	iLast = std::min(iLast, iPieces - 1);
 }
-void displayBezier(std::vector<Point>& ptvEvaluatedCurvePts, const Vec4d& px, const Vec4d& py)
+
+void BezierCurveEvaluator::endValues(const std::vector<Point>& ptvCtrlPts,
+									 const float& fAniLength,
+									 const bool& bWrap,
+									 float& fStartY,
+									 float& fEndY) const
 {
-	Point V[4];
-	for (int i = 0; i < 4; ++i)
-	{
-		V[i] = Point(px[i], py[i]);
-	}
-	if (flatEnough(px, py))
+	// when the wrapping point made the last group the curve covers
+	// the whole animation, and these are never used
+	if (bWrap)
 	{
-		ptvEvaluatedCurvePts.push_back(V[0]);
-		ptvEvaluatedCurvePts.push_back(V[3]);
+		fStartY = fEndY = wrapValue(ptvCtrlPts, fAniLength);
 	}
 	else
 	{
-		Point VV[3];
-		VV[0] = Point((V[0].x + V[1].x)/2, (V[0].y + V[1].y)/2);
-		VV[1] = Point((V[1].x + V[2].x)/2, (V[1].y + V[2].y)/2);
-		VV[2] = Point((V[2].x + V[3].x)/2, (V[2].y + V[3].y)/2);
-		Point VVV[2];
-		VVV[0] = Point((VV[0].x + VV[1].x)/2, (VV[0].y + VV[1].y)/2);
-		VVV[1] = Point((VV[1].x + VV[2].x)/2, (VV[1].y + VV[2].y)/2);
-		Point Q((VVV[0].x + VVV[1].x)/2, (VVV[0].y + VVV[1].y)/2);
-		displayBezier(ptvEvaluatedCurvePts, Vec4d(V[0].x, VV[0].x, VVV[0].x, Q.x), Vec4d(V[0].y, VV[0].y, VVV[0].y, Q.y));
-		displayBezier(ptvEvaluatedCurvePts, Vec4d(Q.x, VVV[1].x, VV[2].x, V[3].x), Vec4d(Q.y, VVV[1].y, VV[2].y, V[3].y));
+		fStartY = ptvCtrlPts.front().y;
+		fEndY = ptvCtrlPts.back().y;
 	}
-
 }
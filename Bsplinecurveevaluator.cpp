@@ -1,80 +1,93 @@
-#include "BsplineCurveEvaluator.h"
-#include "BezierCurveEvaluator.h"
+#include "Bsplinecurveevaluator.h"
 #include <assert.h>
 #include "mat.h"
 #include "vec.h"
-#include "modelerapp.h"
 
-#define SEGMENT 30
+#include <algorithm>
 
-void  BsplineCurveEvaluator::evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-										 std::vector<Point>& ptvEvaluatedCurvePts, 
-										 const float& fAniLength, 
-										 const bool& bWrap,
-										 const bool& bAdaptive,
-										 const double& dTension) const
+// the uniform cubic B-spline in powers of t
+static const Mat4d s_basis = Mat4d(
+	-1, 3, -3, 1,
+	3, -6, 3, 0,
+	-3, 0, 3, 0,
+	1, 4, 1, 0)/6.0;
+
+// Point i of the control points with two more at each end: the end
+// points doubled up or, wrapping, continued round from the other end,
+// so that the curve reaches the first and last.  Piece i is shaped by
+// padded points i to i + 3.
+static Point paddedPoint(const std::vector<Point>& ptvCtrlPts, const int i,
+						 const float fAniLength, const bool bWrap)
 {
-	ptvEvaluatedCurvePts.clear();
-	std::vector<Point> controlPointsCopy;
-	
-	if (bWrap)
-	{
-		Point start_p1 = Point((ptvCtrlPts.end() - 2)->x - fAniLength,
-			(ptvCtrlPts.end() - 2)->y);
-		Point start_p2 = Point((ptvCtrlPts.end() - 1)->x - fAniLength,
-			(ptvCtrlPts.end() - 1)->y);
-		Point end_p1 = Point((ptvCtrlPts.begin())->x + fAniLength, 
-			(ptvCtrlPts.begin())->y);
-		Point end_p2 = Point((ptvCtrlPts.begin() + 1)->x + fAniLength, 
-			(ptvCtrlPts.begin() + 1)->y);
-		controlPointsCopy.push_back(start_p1);
-		controlPointsCopy.push_back(start_p2);
-		controlPointsCopy.insert(controlPointsCopy.end(), ptvCtrlPts.begin(), ptvCtrlPts.end());
-		controlPointsCopy.push_back(end_p1);
-		controlPointsCopy.push_back(end_p2);
-	}
-	else
-	{
-		controlPointsCopy.push_back(ptvCtrlPts.front());
-		controlPointsCopy.push_back(ptvCtrlPts.front());
-		controlPointsCopy.insert(controlPointsCopy.end(), ptvCtrlPts.begin(), ptvCtrlPts.end());
-		controlPointsCopy.push_back(ptvCtrlPts.back());
-		controlPointsCopy.push_back(ptvCtrlPts.back());
-	}
+	int iCtrlPtCount = ptvCtrlPts.size();
+	int j = i - 2;
 
+	if (j < 0)
+		return bWrap ? Point(ptvCtrlPts[iCtrlPtCount + j].x - fAniLength, ptvCtrlPts[iCtrlPtCount + j].y)
+					 : ptvCtrlPts.front();
+	if (j >= iCtrlPtCount)
+		return bWrap ? Point(ptvCtrlPts[j - iCtrlPtCount].x + fAniLength, ptvCtrlPts[j - iCtrlPtCount].y)
+					 : ptvCtrlPts.back();
+	return ptvCtrlPts[j];
+}
 
-	const Mat4d convert = Mat4d(
-		1, 4, 1, 0, 
-		0, 4, 2, 0,
-		0, 2, 4, 0,
-		0, 1, 4, 1)/6.0;
+int BsplineCurveEvaluator::pieceCount(const std::vector<Point>& ptvCtrlPts,
+									  const bool& bWrap) const
+{
+	return ptvCtrlPts.size() + 1;
+}
 
-	BezierCurveEvaluator helper = BezierCurveEvaluator();
-	for (int i = 0; i < controlPointsCopy.size() - 3; ++i)
+void BsplineCurveEvaluator::evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+										   std::vector<CurveSegment>& pieces,
+										   const int iFirst,
+										   const int iLast,
+										   const float& fAniLength,
+										   const bool& bWrap,
+										   const double& dTension) const
+{
+	for (int i = iFirst; i <= iLast; ++i)
 	{
-		Vec4d param_x(controlPointsCopy[i].x, 
-			controlPointsCopy[i+1].x, 
-			controlPointsCopy[i+2].x, 
-			controlPointsCopy[i+3].x);
-		Vec4d param_y(controlPointsCopy[i].y, 
-			controlPointsCopy[i+1].y, 
-			controlPointsCopy[i+2].y, 
-			controlPointsCopy[i+3].y);
-
-		Vec4d convert_x = convert * param_x;
-		Vec4d convert_y = convert * param_y;
-		std::vector<Point> convertBezierPts;
+		Point p[4];
 		for (int j = 0; j < 4; ++j)
-		{
-			convertBezierPts.push_back(Point(convert_x[j], convert_y[j]));
-		}
-		std::vector<Point> input_pts;
-		helper.evaluateCurve(convertBezierPts, input_pts, fAniLength, false, bAdaptive, dTension);
-		ptvEvaluatedCurvePts.insert(ptvEvaluatedCurvePts.end(), input_pts.begin(), input_pts.end());
+			p[j] = paddedPoint(ptvCtrlPts, i + j, fAniLength, bWrap);
+
+		Vec4d param_x(p[0].x, p[1].x, p[2].x, p[3].x);
+		Vec4d param_y(p[0].y, p[1].y, p[2].y, p[3].y);
+		pieces[i].setCubic(s_basis * param_x, s_basis * param_y);
 	}
-	if (!bWrap) 
+}
+
+void BsplineCurveEvaluator::affectedPieces(const std::vector<Point>& ptvCtrlPts,
+										   const int iFirstCtrlPt,
+										   const int iLastCtrlPt,
+										   const bool& bWrap,
+										   int& iFirst,
+										   int& iLast) const
+{
+	int iCtrlPtCount = ptvCtrlPts.size();
+	int iPieces = pieceCount(ptvCtrlPts, bWrap);
+
+	// wrapping repeats the first two points and the last two at the
+	// other end
+	if (bWrap && (iFirstCtrlPt < 2 || iLastCtrlPt >= iCtrlPtCount - 2))
 	{
-		ptvEvaluatedCurvePts.push_back(Point(0, ptvCtrlPts.front().y));
-		ptvEvaluatedCurvePts.push_back(Point(fAniLength, ptvCtrlPts.back().y));
+		iFirst = 0;
+		iLast = iPieces - 1;
+		return;
 	}
-}
\ No newline at end of file
+
+	// padded point k + 2 shapes the four pieces before it
+	iFirst = std::max(iFirstCtrlPt - 1, 0);
+	iLast = std::min(iLastCtrlPt + 2, iPieces - 1);
+}
+
+void BsplineCurveEvaluator::endValues(const std::vector<Point>& ptvCtrlPts,
+									  const float& fAniLength,
+									  const bool& bWrap,
+									  float& fStartY,
+									  float& fEndY) const
+{
+	// wrapped, the pieces cover the whole animation
+	fStartY = ptvCtrlPts.front().y;
+	fEndY = ptvCtrlPts.back().y;
+}
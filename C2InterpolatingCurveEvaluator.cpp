@@ -2,40 +2,125 @@
 #include <assert.h>
 #include "mat.h"
 #include "vec.h"
-#include "modelerapp.h"
-#define SEGMENT 30
 
-void C2InterpolatingCurveEvaluator::evaluateCurve(const std::vector<Point>& controlPoints,
-	std::vector<Point>& evaluatedPoints,
+#include <algorithm>
+
+int C2InterpolatingCurveEvaluator::pieceCount(const std::vector<Point>& controlPoints,
+	const bool& beWrap) const
+{
+	return std::max(beWrap ? (int)controlPoints.size() : (int)controlPoints.size() - 1, 0);
+}
+
+void C2InterpolatingCurveEvaluator::evaluatePieces(const std::vector<Point>& controlPoints,
+	std::vector<CurveSegment>& pieces,
+	const int iFirst,
+	const int iLast,
 	const float& animationLength,
 	const bool& beWrap,
-	const bool& bAdaptive,
 	const double& dTension) const
 {
-	evaluatedPoints.clear();
+	int controlN = pieceCount(controlPoints, beWrap);
 
 	std::vector<Point> controlPointsCopy;
 	controlPointsCopy.insert(controlPointsCopy.end(), controlPoints.begin(), controlPoints.end());
 	controlPointsCopy.push_back(Point(controlPointsCopy.front().x + animationLength,
 		controlPointsCopy.front().y));
 
+	std::vector<float> derivativePoints(controlPointsCopy.size(), 0.0);
+	this->_evaluateDerivative(derivativePoints, controlPointsCopy, controlN);
+
+	// x runs straight from one control point to the next, so only y
+	// is a cubic; the last piece of a wrapped curve ends past the
+	// animation and comes round to the start
+	for (int i = iFirst; i <= iLast; i++)
+	{
+		float length_x = controlPointsCopy[i + 1].x - controlPointsCopy[i].x;
+		pieces[i].setCubic(Vec4d(0, 0, length_x, controlPointsCopy[i].x),
+			this->_coefficients(i, i + 1, controlPointsCopy, derivativePoints));
+	}
+}
+
+void C2InterpolatingCurveEvaluator::reevaluatePieces(const std::vector<Point>& controlPoints,
+	std::vector<CurveSegment>& pieces,
+	int& iFirst,
+	int& iLast,
+	const float& animationLength,
+	const bool& beWrap,
+	const double& dTension) const
+{
+	int controlN = pieceCount(controlPoints, beWrap);
+
+	std::vector<Point> controlPointsCopy;
+	controlPointsCopy.insert(controlPointsCopy.end(), controlPoints.begin(), controlPoints.end());
+	controlPointsCopy.push_back(Point(controlPointsCopy.front().x + animationLength,
+		controlPointsCopy.front().y));
 
 	std::vector<float> derivativePoints(controlPointsCopy.size(), 0.0);
-	int controlN = beWrap ? controlPoints.size() : controlPoints.size() - 1;
 	this->_evaluateDerivative(derivativePoints, controlPointsCopy, controlN);
 
-	for (int i = 0; i < controlN; i++) 
+	// A moved point changes every derivative, by less the further
+	// away it is, until the change is lost to rounding.  Each piece
+	// holds the derivative it starts with, so the derivatives that
+	// came out different say which pieces changed: the two that meet
+	// at each.  The last derivative only ends a piece.
+	for (int i = 0; i < controlN; i++)
 	{
-		this->_evaluate(i, i + 1, animationLength, 
-			controlPointsCopy, evaluatedPoints, derivativePoints);
+		if ((float)pieces[i].y[2] != derivativePoints[i])
+		{
+			iFirst = std::min(iFirst, std::max(i - 1, 0));
+			iLast = std::max(iLast, i);
+		}
+	}
+	if (controlN > 0 && iLast < controlN - 1)
+	{
+		Vec4d last = this->_coefficients(controlN - 1, controlN, controlPointsCopy, derivativePoints);
+		if (last[1] != pieces[controlN - 1].y[1] || last[0] != pieces[controlN - 1].y[0])
+			iLast = controlN - 1;
+	}
+
+	for (int i = iFirst; i <= iLast; i++)
+	{
+		float length_x = controlPointsCopy[i + 1].x - controlPointsCopy[i].x;
+		pieces[i].setCubic(Vec4d(0, 0, length_x, controlPointsCopy[i].x),
+			this->_coefficients(i, i + 1, controlPointsCopy, derivativePoints));
+	}
+}
+
+void C2InterpolatingCurveEvaluator::affectedPieces(const std::vector<Point>& controlPoints,
+	const int iFirstCtrlPt,
+	const int iLastCtrlPt,
+	const bool& beWrap,
+	int& iFirst,
+	int& iLast) const
+{
+	int iPieces = pieceCount(controlPoints, beWrap);
+
+	// the last piece of a wrapped curve ends on the first point
+	if (beWrap && iFirstCtrlPt == 0)
+	{
+		iFirst = 0;
+		iLast = iPieces - 1;
+		return;
 	}
 
-	if (!beWrap) evaluatedPoints.push_back(Point(0, controlPoints.front().y));
-	if (!beWrap) evaluatedPoints.push_back(Point(animationLength, evaluatedPoints.back().y));
+	// the pieces either side of each moved point; reevaluatePieces()
+	// finds those its derivatives reach
+	iFirst = std::max(iFirstCtrlPt - 1, 0);
+	iLast = std::min(iLastCtrlPt, iPieces - 1);
+}
+
+void C2InterpolatingCurveEvaluator::endValues(const std::vector<Point>& controlPoints,
+	const float& animationLength,
+	const bool& beWrap,
+	float& fStartY,
+	float& fEndY) const
+{
+	fStartY = controlPoints.front().y;
+	fEndY = controlPoints.back().y;
 }
 
-void C2InterpolatingCurveEvaluator::_evaluate(const int p1, const int p2, const float& animationLength,
-	const std::vector<Point>& controlPointsCopy, std::vector<Point>& evaluatedPoints,
+Vec4d C2InterpolatingCurveEvaluator::_coefficients(const int p1, const int p2,
+	const std::vector<Point>& controlPointsCopy,
 	const std::vector<float>& derivativePoints) const
 {
 	Mat4d basis = Mat4d(
@@ -45,28 +130,16 @@ void C2InterpolatingCurveEvaluator::_evaluate(const int p1, const int p2, const
 		1.0, 0.0, 0.0, 0.0
 		);
 
-	Vec4d vec = basis * Vec4d(
+	return basis * Vec4d(
 		controlPointsCopy[p1].y,
 		controlPointsCopy[p2].y,
 		derivativePoints[p1],
 		derivativePoints[p2]
 		);
-
-	for (int i = 0; i < SEGMENT; ++i)
-	{
-		double t = i / (double)SEGMENT;
-		float eval_y = Vec4d(t*t*t, t*t, t, 1) * vec;
-
-		float length_x = controlPointsCopy[p2].x - controlPointsCopy[p1].x;
-		if (length_x < 0) length_x += animationLength;
-		float eval_x = controlPointsCopy[p1].x + t * length_x;
-		eval_x = fmod(eval_x, animationLength);
-		evaluatedPoints.push_back(Point(eval_x, eval_y));
-	}
 }
 
 void C2InterpolatingCurveEvaluator::_evaluateDerivative(std::vector<float>& derivative, 
-	std::vector<Point> controlPointsCopy, int controlN) const
+	const std::vector<Point>& controlPointsCopy, int controlN) const
 {
 	std::vector<float> gamma(controlPointsCopy.size(), 0.0);
 	std::vector<float> delta(controlPointsCopy.size(), 0.0);
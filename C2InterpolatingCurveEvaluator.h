@@ -3,29 +3,50 @@
 
 #pragma warning(disable : 4786)  
 
-#include "CurveEvaluator.h"
+#include "curveevaluator.h"
 
 //using namespace std;
 
 class C2InterpolatingCurveEvaluator : public CurveEvaluator
 {
 public:
-	void evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-		std::vector<Point>& ptvEvaluatedCurvePts, 
-		const float& fAniLength, 
+	int pieceCount(const std::vector<Point>& ptvCtrlPts,
+		const bool& bWrap) const override;
+	void evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+		std::vector<CurveSegment>& pieces,
+		const int iFirst,
+		const int iLast,
+		const float& fAniLength,
 		const bool& bWrap,
-		const bool& bAdaptive,
 		const double& dTension) const override;
+	void reevaluatePieces(const std::vector<Point>& ptvCtrlPts,
+		std::vector<CurveSegment>& pieces,
+		int& iFirst,
+		int& iLast,
+		const float& fAniLength,
+		const bool& bWrap,
+		const double& dTension) const override;
+	void affectedPieces(const std::vector<Point>& ptvCtrlPts,
+		const int iFirstCtrlPt,
+		const int iLastCtrlPt,
+		const bool& bWrap,
+		int& iFirst,
+		int& iLast) const override;
+	void endValues(const std::vector<Point>& ptvCtrlPts,
+		const float& fAniLength,
+		const bool& bWrap,
+		float& fStartY,
+		float& fEndY) const override;
 
 private:
 	/*
 	 * Helper function, otherwise to long to write together
 	 */
-	void _evaluate(const int p1, const int p2, const float& animationLength,
-		const std::vector<Point>& controlPointsCopy, std::vector<Point>& evaluatedPoints,
+	Vec4d _coefficients(const int p1, const int p2,
+		const std::vector<Point>& controlPointsCopy,
 		const std::vector<float>& derivativePoints) const;
 	void _evaluateDerivative(std::vector<float>& derivative,
-		std::vector<Point> controlPointsCopy, int controlN) const;
+		const std::vector<Point>& controlPointsCopy, int controlN) const;
 };
 
 #endif
\ No newline at end of file
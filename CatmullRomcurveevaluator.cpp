@@ -1,86 +1,101 @@
-#include "CatmullRomCurveEvaluator.h"
+#include "CatmullRomcurveevaluator.h"
 #include <assert.h>
 #include "mat.h"
 #include "vec.h"
-#include "modelerapp.h"
-#include "modelerglobals.h"
 
-#define SEGMENT 30
+#include <algorithm>
 
-void CatmullRomCurveEvaluator::evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-										 std::vector<Point>& ptvEvaluatedCurvePts, 
-										 const float& fAniLength, 
-										 const bool& bWrap,
-										 const bool& bAdaptive,
-										 const double& dTension) const
+// scaled by the tension, which is 0.5 for a true Catmull-Rom curve
+static const Mat4d s_basis = Mat4d(
+	-1, 3, -3, 1,
+	2, -5, 4, -1,
+	-1, 0, 1, 0,
+	0, 2, 0, 0);
+
+// control points added at each end so the curve reaches the first
+// and last
+static int padding(const bool bWrap)
 {
-	ptvEvaluatedCurvePts.clear();
+	return bWrap ? 2 : 1;
+}
 
-	std::vector<Point> controlPointsCopy;
+// Point i of the control points with the padding: the end points
+// repeated or, wrapping, continued round from the other end.  Piece
+// i is shaped by padded points i to i + 3.
+static Point paddedPoint(const std::vector<Point>& ptvCtrlPts, const int i,
+						 const float fAniLength, const bool bWrap)
+{
+	int iCtrlPtCount = ptvCtrlPts.size();
+	int j = i - padding(bWrap);
 
-	if (bWrap)
-	{
-		Point start_p1 = Point((ptvCtrlPts.end() - 2)->x - fAniLength, 
-			(ptvCtrlPts.end() - 2)->y);
-		Point start_p2 = Point((ptvCtrlPts.end() - 1)->x - fAniLength,
-			(ptvCtrlPts.end() -1)->y);
-		Point end_p1 = Point((ptvCtrlPts.begin())->x + fAniLength, 
-			(ptvCtrlPts.begin())->y);
-		Point end_p2 = Point((ptvCtrlPts.begin()+1)->x + fAniLength,
-			(ptvCtrlPts.begin()+1)->y);
-		controlPointsCopy.push_back(start_p1);
-		controlPointsCopy.push_back(start_p2);
-		controlPointsCopy.insert(controlPointsCopy.end(), ptvCtrlPts.begin(), ptvCtrlPts.end());
-		controlPointsCopy.push_back(end_p1);
-		controlPointsCopy.push_back(end_p2);
-	}
-	else 
-	{
-		controlPointsCopy.push_back(ptvCtrlPts.front());
-		controlPointsCopy.insert(controlPointsCopy.end(), ptvCtrlPts.begin(), ptvCtrlPts.end());
-		controlPointsCopy.push_back(ptvCtrlPts.back());
-	}
+	if (j < 0)
+		return bWrap ? Point(ptvCtrlPts[iCtrlPtCount + j].x - fAniLength, ptvCtrlPts[iCtrlPtCount + j].y)
+					 : ptvCtrlPts.front();
+	if (j >= iCtrlPtCount)
+		return bWrap ? Point(ptvCtrlPts[j - iCtrlPtCount].x + fAniLength, ptvCtrlPts[j - iCtrlPtCount].y)
+					 : ptvCtrlPts.back();
+	return ptvCtrlPts[j];
+}
 
-	const Mat4d basis = Mat4d(
-		-1, 3, -3, 1,
-		2, -5, 4, -1,
-		-1, 0, 1, 0,
-		0, 2, 0, 0)*dTension;
+int CatmullRomCurveEvaluator::pieceCount(const std::vector<Point>& ptvCtrlPts,
+										 const bool& bWrap) const
+{
+	return std::max((int)ptvCtrlPts.size() + 2 * padding(bWrap) - 3, 0);
+}
 
-	for (int i = 0; i < controlPointsCopy.size() - 3; ++i)
+void CatmullRomCurveEvaluator::evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+											  std::vector<CurveSegment>& pieces,
+											  const int iFirst,
+											  const int iLast,
+											  const float& fAniLength,
+											  const bool& bWrap,
+											  const double& dTension) const
+{
+	const Mat4d basis = s_basis * dTension;
+
+	for (int i = iFirst; i <= iLast; ++i)
 	{
-		Vec4d param_x = Vec4d(
-			controlPointsCopy[i].x, 
-			controlPointsCopy[i+1].x,
-			controlPointsCopy[i+2].x,
-			controlPointsCopy[i+3].x);
-		Vec4d param_y = Vec4d(
-			controlPointsCopy[i].y,
-			controlPointsCopy[i+1].y,
-			controlPointsCopy[i+2].y,
-			controlPointsCopy[i+3].y);
-		for (int t = 0; t < SEGMENT; ++t)
-		{
-			double time = (double)t/(double)SEGMENT;
-			Vec4d param_time = Vec4d(time*time*time, time*time, time, 1);
-			Point eval_point = Point(param_time * basis * param_x, param_time * basis * param_y);
-			if (ptvEvaluatedCurvePts.empty() || eval_point.x > ptvEvaluatedCurvePts.back().x)
-			{
-				ptvEvaluatedCurvePts.push_back(eval_point);
-			}
-		}
+		Point p[4];
+		for (int j = 0; j < 4; ++j)
+			p[j] = paddedPoint(ptvCtrlPts, i + j, fAniLength, bWrap);
+
+		Vec4d param_x = Vec4d(p[0].x, p[1].x, p[2].x, p[3].x);
+		Vec4d param_y = Vec4d(p[0].y, p[1].y, p[2].y, p[3].y);
+		pieces[i].setCubic(basis * param_x, basis * param_y);
 	}
-	if (!bWrap)
+}
+
+void CatmullRomCurveEvaluator::affectedPieces(const std::vector<Point>& ptvCtrlPts,
+											  const int iFirstCtrlPt,
+											  const int iLastCtrlPt,
+											  const bool& bWrap,
+											  int& iFirst,
+											  int& iLast) const
+{
+	int iCtrlPtCount = ptvCtrlPts.size();
+	int iPieces = pieceCount(ptvCtrlPts, bWrap);
+
+	// wrapping repeats the first two points and the last two at the
+	// other end
+	if (bWrap && (iFirstCtrlPt < 2 || iLastCtrlPt >= iCtrlPtCount - 2))
 	{
-		if (ptvCtrlPts.front().x < ptvEvaluatedCurvePts.front().x)
-		{
-			ptvEvaluatedCurvePts.push_back(ptvCtrlPts.front());
-		}
-		if (ptvCtrlPts.back().x > ptvEvaluatedCurvePts.back().x)
-		{
-			ptvEvaluatedCurvePts.push_back(ptvCtrlPts.back());
-		}
-		ptvEvaluatedCurvePts.push_back(Point(0, ptvEvaluatedCurvePts.front().y));
-		ptvEvaluatedCurvePts.push_back(Point(fAniLength, ptvEvaluatedCurvePts.back().y));
+		iFirst = 0;
+		iLast = iPieces - 1;
+		return;
 	}
+
+	// padded point k + padding shapes the four pieces before it
+	iFirst = std::max(iFirstCtrlPt + padding(bWrap) - 3, 0);
+	iLast = std::min(iLastCtrlPt + padding(bWrap), iPieces - 1);
+}
+
+void CatmullRomCurveEvaluator::endValues(const std::vector<Point>& ptvCtrlPts,
+										 const float& fAniLength,
+										 const bool& bWrap,
+										 float& fStartY,
+										 float& fEndY) const
+{
+	// wrapped, the pieces cover the whole animation
+	fStartY = ptvCtrlPts.front().y;
+	fEndY = ptvCtrlPts.back().y;
 }
@@ -1,12 +1,131 @@
 #include "Force.h"
 #include "particle.h"
+#include "spatialGrid.h"
+#include "randomStream.h"
 
-void Gravity::addForce(Particle* particle)
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.141592653589793238462643383279502
+#endif
+
+void Gravity::apply(const ParticleSpan& span)
+{
+	const double gx = g[0], gy = g[1], gz = g[2];
+	for (int i = 0; i < span.count; ++i)
+	{
+		span.fx[i] += gx * span.mass[i];
+		span.fy[i] += gy * span.mass[i];
+		span.fz[i] += gz * span.mass[i];
+	}
+}
+
+void Viscous::apply(const ParticleSpan& span)
+{
+	const double k = K;
+	for (int i = 0; i < span.count; ++i)
+	{
+		span.fx[i] -= k * span.vx[i];
+		span.fy[i] -= k * span.vy[i];
+		span.fz[i] -= k * span.vz[i];
+	}
+}
+
+// The unit vector from particle idOther to particle idSelf when the
+// two sit on the same spot: a direction drawn from the pair's ids, so
+// each gets the opposite of the other's and every run the same ones
+static void coincidentDirection(unsigned int idSelf, unsigned int idOther, double& ux, double& uy, double& uz)
+{
+	unsigned int lo = (idSelf < idOther) ? idSelf : idOther;
+	unsigned int hi = (idSelf < idOther) ? idOther : idSelf;
+	RandomStream rs(lo, hi);
+	double z = rs.uniform(-1.0, 1.0);
+	double phi = rs.uniform(0.0, 2.0 * M_PI);
+	double r = sqrt(1.0 - z * z);
+	double sign = (idSelf == lo) ? 1.0 : -1.0;
+	ux = sign * r * cos(phi);
+	uy = sign * r * sin(phi);
+	uz = sign * z;
+}
+
+// Sums profile(d / radius) * the unit vector from each neighbour
+// within radius into the particle's force, scaled by gain
+template <class Profile>
+static void applyPairForce(const ParticleSpan& span, double radius, double gain, Profile profile)
+{
+	if (!span.grid)
+		return;
+
+	const double r2 = radius * radius;
+	const double invR = 1.0 / radius;
+
+	for (int i = 0; i < span.count; ++i)
+	{
+		if (span.id[i] == ParticleStore::kDeadId)
+			continue;
+
+		const int self = span.begin + i;
+		const double x = span.px[i], y = span.py[i], z = span.pz[i];
+		double fx = 0.0, fy = 0.0, fz = 0.0;
+		span.grid->forEachCandidate(x, y, z, [&](int j, double xj, double yj, double zj)
+		{
+			double dx = x - xj, dy = y - yj, dz = z - zj;
+			double d2 = dx * dx + dy * dy + dz * dz;
+			if (d2 >= r2 || j == self)
+				return;
+			if (d2 == 0.0)
+			{
+				// no direction between them to push along; make one
+				double ux, uy, uz;
+				coincidentDirection(span.id[i], span.store->id[j], ux, uy, uz);
+				double s = profile(0.0);
+				fx += ux * s;
+				fy += uy * s;
+				fz += uz * s;
+				return;
+			}
+			double d = sqrt(d2);
+			double s = profile(d * invR) / d;
+			fx += dx * s;
+			fy += dy * s;
+			fz += dz * s;
+		});
+		span.fx[i] += fx * gain;
+		span.fy[i] += fy * gain;
+		span.fz[i] += fz * gain;
+	}
+}
+
+static inline double repulsionProfile(double q) { return 1.0 - q; }
+static inline double cohesionProfile(double q) { return -4.0 * q * (1.0 - q); }
+
+void Repulsion::apply(const ParticleSpan& span)
+{
+	applyPairForce(span, radius, stiffness, repulsionProfile);
+}
+
+void Cohesion::apply(const ParticleSpan& span)
+{
+	applyPairForce(span, radius, strength, cohesionProfile);
+}
+
+void Attraction::prepare(const ParticleStore& particles)
 {
-	particle->setNetForce(particle->getNetForce() + g * particle->getMass());
+	tree.build(particles);
 }
 
-void Viscous::addForce(Particle* particle)
+void Attraction::apply(const ParticleSpan& span)
 {
-	particle->setNetForce(particle->getNetForce() - K * particle->getSpeed());
+	const double eps2 = softening * softening;
+	for (int i = 0; i < span.count; ++i)
+	{
+		if (span.id[i] == ParticleStore::kDeadId)
+			continue;
+		double gx, gy, gz;
+		tree.field(span.px[i], span.py[i], span.pz[i], span.begin + i, theta, eps2, gx, gy, gz);
+		double s = G * span.mass[i];
+		span.fx[i] += gx * s;
+		span.fy[i] += gy * s;
+		span.fz[i] += gz * s;
+	}
 }
\ No newline at end of file
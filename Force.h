@@ -2,28 +2,82 @@
 #define FORCE_H
 
 #include "vec.h"
+#include "particle.h"
+#include "octree.h"
 #include <vector>
 #include <map>
 
-class Particle;
-
 class Force {
 public:
-	virtual void addForce(Particle* particle) = 0;
+	virtual ~Force() {}
+	// accumulates this force into the net force of every
+	// particle in the span; one virtual call per span
+	virtual void apply(const ParticleSpan& span) = 0;
+	// how far this force looks for other particles; when any force
+	// returns more than 0, spans come with a grid of that cell size
+	virtual double neighbourRadius() const { return 0.0; }
+	// called with the whole store before each force evaluation, for
+	// forces that build a structure over all the particles first
+	virtual void prepare(const ParticleStore& particles) {}
+	// whether the force depends on the particles' speeds as well as
+	// their positions, which keeps integrators from reusing it
+	virtual bool speedDependent() const { return false; }
 };
 
 class Gravity : public Force {
 public:
 	Gravity(Vec3d v) : g(v) {}
 	Vec3d g;   //gravity
-	virtual void addForce(Particle* particle);
+	virtual void apply(const ParticleSpan& span);
 };
 
 class Viscous : public Force {
 public:
 	Viscous(double m) : K(m) {}
 	double K;  // k of the force
-	virtual void addForce(Particle* particle);
+	virtual void apply(const ParticleSpan& span);
+	virtual bool speedDependent() const { return true; }
+};
+
+// Pushes apart particles closer than radius, like soft spheres of
+// that diameter; strongest (stiffness) when they coincide, 0 at radius
+class Repulsion : public Force {
+public:
+	Repulsion(double r, double k) : radius(r), stiffness(k) {}
+	double radius;
+	double stiffness;
+	virtual void apply(const ParticleSpan& span);
+	virtual double neighbourRadius() const { return radius; }
+};
+
+// Pulls particles within radius of each other together, peaking
+// (at strength) halfway out; with a shorter ranged Repulsion it
+// makes the particles clump into blobs
+class Cohesion : public Force {
+public:
+	Cohesion(double r, double s) : radius(r), strength(s) {}
+	double radius;
+	double strength;
+	virtual void apply(const ParticleSpan& span);
+	virtual double neighbourRadius() const { return radius; }
+};
+
+// Every particle attracts every other one with G m1 m2 / (d^2 + eps^2),
+// summed Barnes-Hut style over an octree rebuilt before each
+// evaluation.  Larger theta (0.5 - 1 are typical) trades accuracy
+// for speed; theta = 0 is the exact O(n^2) sum.
+class Attraction : public Force {
+public:
+	Attraction(double G, double theta = 0.5, double softening = 0.05)
+		: G(G), theta(theta), softening(softening) {}
+	double G;
+	double theta;
+	double softening;		// eps; keeps close encounters finite
+	virtual void prepare(const ParticleStore& particles);
+	virtual void apply(const ParticleSpan& span);
+
+private:
+	Octree tree;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "bakeCache.h"
+#include "bakeCodec.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+
+/*****************
+ * .pcache layout
+ *****************/
+
+// A 32 byte header (magic, version, fps, frame count, index offset),
+// the encoded frames each starting on an 8 byte boundary, then the
+// index: an offset and a size per frame, size 0 for frames that
+// were never baked.  Everything is little-endian.
+static const char kMagic[8] = { 'P', 'C', 'A', 'C', 'H', 'E', 0, 0 };
+static const unsigned int kVersion = 2;
+static const size_t kFileHeaderSize = 32;
+static const size_t kIndexEntrySize = 16;
+
+// off-grid times closer than this (in frames) snap to the frame
+const float BakeCache::kFrameEpsilon = 0.001f;
+
+BakeCache::BakeCache(float fFps) :
+	m_fFps(fFps),
+	m_bCompress(true),
+	m_iBakedCount(0)
+{
+}
+
+void BakeCache::fps(float fFps)
+{
+	if (fFps <= 0.0f || fFps == m_fFps)
+		return;
+	clear();
+	m_fFps = fFps;
+}
+
+int BakeCache::frameAt(float t) const
+{
+	return (int)floor(t * m_fFps + 0.5);
+}
+
+bool BakeCache::onFrame(float t) const
+{
+	double f = t * m_fFps;
+	return fabs(f - floor(f + 0.5)) < kFrameEpsilon;
+}
+
+bool BakeCache::hasFrame(int iFrame) const
+{
+	return iFrame >= 0 && iFrame < (int)m_frames.size() && m_frames[iFrame].count >= 0;
+}
+
+bool BakeCache::covers(float t) const
+{
+	if (onFrame(t))
+		return hasFrame(frameAt(t));
+
+	int iFrame = (int)floor(t * m_fFps);
+	return hasFrame(iFrame) && hasFrame(iFrame + 1);
+}
+
+void BakeCache::store(int iFrame, const ParticleStore& particles)
+{
+	if (iFrame < 0)
+		return;
+	if (iFrame >= (int)m_frames.size())
+		m_frames.resize(iFrame + 1);
+
+	Frame& frame = m_frames[iFrame];
+	if (frame.count < 0)
+		++m_iBakedCount;
+
+	frame.count = particles.size();
+	frame.mapped = NULL;
+	frame.mappedSize = 0;
+	frame.data.clear();
+	encodeBakeFrame(particles, m_bCompress, frame.data);
+	// drop the slack left by growing the encode buffer
+	std::vector<unsigned char>(frame.data).swap(frame.data);
+}
+
+bool BakeCache::load(int iFrame, ParticleStore& particles) const
+{
+	if (!hasFrame(iFrame))
+		return false;
+
+	size_t uSize;
+	const unsigned char* data = frameData(m_frames[iFrame], uSize);
+	return decodeBakeFrame(data, uSize, particles) >= 0;
+}
+
+bool BakeCache::sample(float t, ParticleStore& particles) const
+{
+	if (onFrame(t))
+		return load(frameAt(t), particles);
+
+	double f = t * m_fFps;
+	int iFrame = (int)floor(f);
+	if (!load(iFrame, m_scratchA) || !load(iFrame + 1, m_scratchB))
+		return false;
+
+	const ParticleStore& a = m_scratchA;
+	const ParticleStore& b = m_scratchB;
+	double alpha = f - iFrame;
+	// a slot holds the same particle in both frames if the ids match;
+	// otherwise it died, was recycled or was moved by a compaction in
+	// between, and frame a's state is shown as is
+	int n = a.size();
+	int nBoth = (n < b.size()) ? n : b.size();
+	particles.resize(n);
+	const unsigned int* idA = a.id.empty() ? NULL : &a.id[0];
+	const unsigned int* idB = b.id.empty() ? NULL : &b.id[0];
+
+	const std::vector<double>* from[6] = { &a.px, &a.py, &a.pz, &a.vx, &a.vy, &a.vz };
+	const std::vector<double>* to[6] = { &b.px, &b.py, &b.pz, &b.vx, &b.vy, &b.vz };
+	std::vector<double>* out[6] = {
+		&particles.px, &particles.py, &particles.pz,
+		&particles.vx, &particles.vy, &particles.vz };
+	for (int c = 0; c < 6; ++c) {
+		const std::vector<double>& pa = *from[c];
+		const std::vector<double>& pb = *to[c];
+		std::vector<double>& po = *out[c];
+		for (int i = 0; i < nBoth; ++i)
+			po[i] = (idA[i] == idB[i]) ? pa[i] + (pb[i] - pa[i]) * alpha : pa[i];
+		for (int i = nBoth; i < n; ++i)
+			po[i] = pa[i];
+	}
+	float fAgeStep = (float)(alpha / m_fFps);
+	for (int i = 0; i < n; ++i)
+	{
+		particles.mass[i] = a.mass[i];
+		particles.age[i] = a.age[i] + fAgeStep;
+		particles.lifetime[i] = a.lifetime[i];
+		particles.id[i] = a.id[i];
+	}
+	particles.rebuildFreeList();
+	return true;
+}
+
+void BakeCache::clear()
+{
+	m_frames.clear();
+	m_iBakedCount = 0;
+	m_file.close();
+}
+
+int BakeCache::firstFrame() const
+{
+	for (int i = 0; i < (int)m_frames.size(); ++i) {
+		if (m_frames[i].count >= 0)
+			return i;
+	}
+	return -1;
+}
+
+int BakeCache::lastFrame() const
+{
+	for (int i = (int)m_frames.size() - 1; i >= 0; --i) {
+		if (m_frames[i].count >= 0)
+			return i;
+	}
+	return -1;
+}
+
+size_t BakeCache::memoryUsage() const
+{
+	size_t uBytes = m_frames.size() * sizeof(Frame);
+	for (int i = 0; i < (int)m_frames.size(); ++i)
+		uBytes += m_frames[i].data.capacity();
+	return uBytes;
+}
+
+const unsigned char* BakeCache::frameData(const Frame& frame, size_t& uSize) const
+{
+	if (frame.mapped) {
+		uSize = frame.mappedSize;
+		return frame.mapped;
+	}
+	uSize = frame.data.size();
+	return frame.data.empty() ? NULL : &frame.data[0];
+}
+
+void BakeCache::detach()
+{
+	if (!m_file.isOpen())
+		return;
+
+	for (int i = 0; i < (int)m_frames.size(); ++i) {
+		Frame& frame = m_frames[i];
+		if (frame.mapped) {
+			frame.data.assign(frame.mapped, frame.mapped + frame.mappedSize);
+			frame.mapped = NULL;
+			frame.mappedSize = 0;
+		}
+	}
+	m_file.close();
+}
+
+static void putU32(unsigned char* p, unsigned int v) { memcpy(p, &v, 4); }
+static void putU64(unsigned char* p, unsigned long long v) { memcpy(p, &v, 8); }
+static unsigned int getU32(const unsigned char* p) { unsigned int v; memcpy(&v, p, 4); return v; }
+static unsigned long long getU64(const unsigned char* p) { unsigned long long v; memcpy(&v, p, 8); return v; }
+
+bool BakeCache::save(const char* szFileName)
+{
+	// we may be about to overwrite the file we're mapped from
+	detach();
+
+	FILE* fp = fopen(szFileName, "wb");
+	if (!fp)
+		return false;
+
+	// the header is filled in last, once the index offset is known
+	static const unsigned char zeros[8] = { 0 };
+	unsigned char header[kFileHeaderSize] = { 0 };
+	bool bOk = fwrite(header, 1, kFileHeaderSize, fp) == kFileHeaderSize;
+	unsigned long long uOffset = kFileHeaderSize;
+
+	std::vector<unsigned char> index(m_frames.size() * kIndexEntrySize, 0);
+	for (int i = 0; i < (int)m_frames.size() && bOk; ++i) {
+		const Frame& frame = m_frames[i];
+		if (frame.count < 0)
+			continue;
+
+		size_t uPad = (size_t)(-(long long)uOffset & 7);
+		bOk = fwrite(zeros, 1, uPad, fp) == uPad;
+		uOffset += uPad;
+
+		putU64(&index[i * kIndexEntrySize], uOffset);
+		putU64(&index[i * kIndexEntrySize + 8], frame.data.size());
+		bOk = bOk && fwrite(&frame.data[0], 1, frame.data.size(), fp) == frame.data.size();
+		uOffset += frame.data.size();
+	}
+
+	size_t uPad = (size_t)(-(long long)uOffset & 7);
+	bOk = bOk && fwrite(zeros, 1, uPad, fp) == uPad;
+	uOffset += uPad;
+	bOk = bOk && (index.empty() || fwrite(&index[0], 1, index.size(), fp) == index.size());
+
+	memcpy(header, kMagic, 8);
+	putU32(header + 8, kVersion);
+	memcpy(header + 12, &m_fFps, 4);
+	putU32(header + 16, (unsigned int)m_frames.size());
+	putU64(header + 24, uOffset);
+	bOk = bOk && fseek(fp, 0, SEEK_SET) == 0 && fwrite(header, 1, kFileHeaderSize, fp) == kFileHeaderSize;
+
+	if (fclose(fp) != 0)
+		bOk = false;
+	if (!bOk)
+		return false;
+
+	// play back from the file from now on
+	open(szFileName);
+	return true;
+}
+
+bool BakeCache::open(const char* szFileName)
+{
+	MappedFile file;
+	if (!file.open(szFileName))
+		return false;
+
+	const unsigned char* base = file.data();
+	size_t uFileSize = file.size();
+	if (uFileSize < kFileHeaderSize || memcmp(base, kMagic, 8) != 0 || getU32(base + 8) != kVersion)
+		return false;
+
+	float fFps;
+	memcpy(&fFps, base + 12, 4);
+	unsigned int uFrameCount = getU32(base + 16);
+	unsigned long long uIndexOffset = getU64(base + 24);
+	if (!(fFps > 0.0f) || uIndexOffset > uFileSize ||
+		uFrameCount > (uFileSize - uIndexOffset) / kIndexEntrySize)
+		return false;
+
+	std::vector<Frame> frames(uFrameCount);
+	int iBakedCount = 0;
+	const unsigned char* index = base + uIndexOffset;
+	for (unsigned int i = 0; i < uFrameCount; ++i) {
+		unsigned long long uOffset = getU64(index + i * kIndexEntrySize);
+		unsigned long long uSize = getU64(index + i * kIndexEntrySize + 8);
+		if (uSize == 0)
+			continue;
+		if (uOffset < kFileHeaderSize || uOffset > uIndexOffset || uSize > uIndexOffset - uOffset)
+			return false;
+
+		Frame& frame = frames[i];
+		frame.mapped = base + uOffset;
+		frame.mappedSize = (size_t)uSize;
+		frame.count = bakeFrameCount(frame.mapped, frame.mappedSize);
+		if (frame.count < 0)
+			return false;
+		++iBakedCount;
+	}
+
+	// the views stay valid across the swap; only the handles move
+	clear();
+	m_frames.swap(frames);
+	m_iBakedCount = iBakedCount;
+	m_fFps = fFps;
+	m_file.swap(file);
+	return true;
+}
@@ -0,0 +1,98 @@
+#ifndef BAKE_CACHE_H
+#define BAKE_CACHE_H
+
+#include <vector>
+#include <cstddef>
+
+#include "particle.h"
+#include "mappedFile.h"
+
+// Baked particle states indexed by integer frame number at the bake
+// frame rate (frame f holds the state at time f / fps).  Lookup is a
+// vector index, every frame keeps its particles in one contiguous
+// block, and times between two baked frames are answered by
+// interpolating the neighbours, so any time inside the baked range
+// can be shown without simulating.  Frames are kept in the compact
+// format of bakeCodec.h, optionally LZ compressed.
+//
+// A cache can be saved to a .pcache file and opened again later.  An
+// opened file is memory mapped rather than read, so frames are paged
+// in as playback reaches them and resident memory stays flat however
+// long the bake is.  Frames stored after opening are kept in memory
+// until the next save.
+class BakeCache {
+public:
+	BakeCache(float fFps = 30.0f);
+
+	// Changing the frame rate throws away every baked frame
+	void fps(float fFps);
+	float fps() const { return m_fFps; }
+
+	// LZ compress frames stored from now on (on by default)
+	void compress(bool bCompress) { m_bCompress = bCompress; }
+	bool compress() const { return m_bCompress; }
+
+	// Nearest frame to time t, and the time of a frame
+	int frameAt(float t) const;
+	float timeOf(int iFrame) const { return iFrame / m_fFps; }
+	// True when t is within kFrameEpsilon frames of a frame boundary
+	bool onFrame(float t) const;
+
+	bool hasFrame(int iFrame) const;
+	// True if t is a baked frame or lies between two baked frames
+	bool covers(float t) const;
+
+	// Saves position, speed, mass, age and id of every slot as frame iFrame
+	void store(int iFrame, const ParticleStore& particles);
+	// Restores frame iFrame (to quantization precision); false if it is not baked
+	bool load(int iFrame, ParticleStore& particles) const;
+	// Restores the state at time t, interpolating between the two
+	// neighbouring frames when t is off the frame grid.  The slots
+	// of the earlier frame are returned; those holding a different
+	// particle in the later one are not interpolated.
+	bool sample(float t, ParticleStore& particles) const;
+
+	void clear();
+	bool empty() const { return m_iBakedCount == 0; }
+	// first/last baked frame, -1 when empty
+	int firstFrame() const;
+	int lastFrame() const;
+	// bytes of baked frames held in memory (mapped frames don't count)
+	size_t memoryUsage() const;
+
+	// Writes every baked frame to a .pcache file and maps it back in,
+	// releasing the in-memory copies.  False if the file can't be written.
+	bool save(const char* szFileName);
+	// Replaces the cache (frame rate included) with the frames of a
+	// .pcache file.  False, leaving the cache untouched, if the file
+	// is missing or malformed.
+	bool open(const char* szFileName);
+
+	static const float kFrameEpsilon;
+
+private:
+	struct Frame {
+		Frame() : count(-1), mapped(NULL), mappedSize(0) {}
+		int count;							// -1 = not baked
+		std::vector<unsigned char> data;	// encodeBakeFrame() output
+		const unsigned char* mapped;		// or the same, inside m_file
+		size_t mappedSize;
+	};
+
+	// Encoded bytes of a baked frame, wherever they live
+	const unsigned char* frameData(const Frame& frame, size_t& uSize) const;
+	// Copies mapped frames into memory and unmaps the file
+	void detach();
+
+	float m_fFps;
+	bool m_bCompress;
+	int m_iBakedCount;
+	std::vector<Frame> m_frames;
+	MappedFile m_file;
+
+	// decode targets for interpolation
+	mutable ParticleStore m_scratchA;
+	mutable ParticleStore m_scratchB;
+};
+
+#endif // BAKE_CACHE_H
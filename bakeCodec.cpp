@@ -0,0 +1,349 @@
+#include "bakeCodec.h"
+#include "particle.h"
+
+#include <math.h>
+#include <string.h>
+
+// quantized columns: px py pz vx vy vz
+static const int kQuantColumns = 6;
+
+// count, flags, raw payload size, stored payload size, then the
+// offset and step of every quantized column
+static const size_t kHeaderSize = 4 * sizeof(unsigned int) + 2 * kQuantColumns * sizeof(double);
+
+// raw payload bytes per particle: 2 byte planes per quantized
+// column, then 4 each for the mass, age, lifetime and id
+static const size_t kBytesPerParticle = 2 * kQuantColumns + 4 * 4;
+
+static const int kMinMatch = 4;
+static const int kHashBits = 14;
+static const size_t kMaxOffset = 65535;
+
+/***************
+ * LZ77 coding
+ ***************/
+
+// Sequences are a token (literal length << 4 | match length - 4),
+// optional length extension bytes, the literals, then a 2 byte match
+// offset.  The last sequence carries literals only.
+
+static void putLength(std::vector<unsigned char>& out, size_t len)
+{
+	while (len >= 255) {
+		out.push_back(255);
+		len -= 255;
+	}
+	out.push_back((unsigned char)len);
+}
+
+static void putSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t litLen,
+						size_t matchLen, size_t offset)
+{
+	size_t matchCode = matchLen ? matchLen - kMinMatch : 0;
+	out.push_back((unsigned char)(((litLen < 15 ? litLen : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+	if (litLen >= 15)
+		putLength(out, litLen - 15);
+	out.insert(out.end(), literals, literals + litLen);
+
+	if (matchLen == 0)
+		return;
+	out.push_back((unsigned char)(offset & 0xff));
+	out.push_back((unsigned char)(offset >> 8));
+	if (matchCode >= 15)
+		putLength(out, matchCode - 15);
+}
+
+static void lzCompress(const unsigned char* in, size_t n, std::vector<unsigned char>& out)
+{
+	std::vector<int> table(1 << kHashBits, -1);
+	size_t anchor = 0;
+	size_t i = 0;
+
+	while (i + kMinMatch <= n) {
+		unsigned int seq;
+		memcpy(&seq, in + i, sizeof(seq));
+		unsigned int h = (seq * 2654435761u) >> (32 - kHashBits);
+		int candidate = table[h];
+		table[h] = (int)i;
+
+		if (candidate >= 0 && i - candidate <= kMaxOffset && memcmp(in + candidate, in + i, kMinMatch) == 0) {
+			size_t len = kMinMatch;
+			while (i + len < n && in[candidate + len] == in[i + len])
+				++len;
+			putSequence(out, in + anchor, i - anchor, len, i - candidate);
+			i += len;
+			anchor = i;
+		}
+		else {
+			++i;
+		}
+	}
+	putSequence(out, in + anchor, n - anchor, 0, 0);
+}
+
+static bool getLength(const unsigned char*& ip, const unsigned char* end, size_t& len)
+{
+	unsigned char b;
+	do {
+		if (ip >= end)
+			return false;
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+	return true;
+}
+
+static bool lzDecompress(const unsigned char* ip, size_t n, unsigned char* out, size_t outSize)
+{
+	const unsigned char* end = ip + n;
+	unsigned char* op = out;
+	unsigned char* outEnd = out + outSize;
+
+	while (ip < end) {
+		unsigned char token = *ip++;
+
+		size_t litLen = token >> 4;
+		if (litLen == 15 && !getLength(ip, end, litLen))
+			return false;
+		if (litLen > (size_t)(end - ip) || litLen > (size_t)(outEnd - op))
+			return false;
+		memcpy(op, ip, litLen);
+		op += litLen;
+		ip += litLen;
+
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t matchLen = token & 15;
+		if (matchLen == 15 && !getLength(ip, end, matchLen))
+			return false;
+		matchLen += kMinMatch;
+
+		if (offset == 0 || offset > (size_t)(op - out) || matchLen > (size_t)(outEnd - op))
+			return false;
+		// matches may overlap their own output
+		const unsigned char* match = op - offset;
+		for (size_t k = 0; k < matchLen; ++k)
+			op[k] = match[k];
+		op += matchLen;
+	}
+	return op == outEnd;
+}
+
+/*****************
+ * Frame encoding
+ *****************/
+
+// 4 byte planes holding col[i] as a float
+template <class T>
+static void putFloatPlanes(const T* col, int n, unsigned char* planes)
+{
+	for (int i = 0; i < n; ++i) {
+		float f = (float)col[i];
+		unsigned int bits;
+		memcpy(&bits, &f, 4);
+		for (int b = 0; b < 4; ++b)
+			planes[b * n + i] = (unsigned char)(bits >> (8 * b));
+	}
+}
+
+template <class T>
+static void getFloatPlanes(const unsigned char* planes, int n, T* col)
+{
+	for (int i = 0; i < n; ++i) {
+		unsigned int bits = planes[i] | (planes[n + i] << 8) |
+			(planes[2 * n + i] << 16) | ((unsigned int)planes[3 * n + i] << 24);
+		float f;
+		memcpy(&f, &bits, 4);
+		col[i] = f;
+	}
+}
+
+static void putU32(std::vector<unsigned char>& out, unsigned int v)
+{
+	unsigned char b[4];
+	memcpy(b, &v, 4);
+	out.insert(out.end(), b, b + 4);
+}
+
+static void putF64(std::vector<unsigned char>& out, double v)
+{
+	unsigned char b[8];
+	memcpy(b, &v, 8);
+	out.insert(out.end(), b, b + 8);
+}
+
+void encodeBakeFrame(const ParticleStore& particles, bool bCompress, std::vector<unsigned char>& out)
+{
+	int n = particles.size();
+	const std::vector<double>* columns[kQuantColumns] = {
+		&particles.px, &particles.py, &particles.pz,
+		&particles.vx, &particles.vy, &particles.vz };
+
+	const std::vector<unsigned int>& id = particles.id;
+
+	double lo[kQuantColumns];
+	double step[kQuantColumns];
+	std::vector<unsigned char> raw(n * kBytesPerParticle);
+
+	for (int c = 0; c < kQuantColumns; ++c) {
+		// dead slots hold stale values; leave them out of the range
+		// so they don't cost the live particles precision
+		const std::vector<double>& col = *columns[c];
+		double fMin = 0.0, fMax = 0.0;
+		bool bFirst = true;
+		for (int i = 0; i < n; ++i) {
+			if (id[i] == ParticleStore::kDeadId)
+				continue;
+			if (bFirst || col[i] < fMin) fMin = col[i];
+			if (bFirst || col[i] > fMax) fMax = col[i];
+			bFirst = false;
+		}
+		lo[c] = fMin;
+		step[c] = (fMax - fMin) / 65535.0;
+
+		// delta along the particle index, zigzagged, low and high byte planes
+		unsigned char* lowPlane = &raw[0] + (2 * c) * n;
+		unsigned char* highPlane = lowPlane + n;
+		unsigned short prev = 0;
+		for (int i = 0; i < n; ++i) {
+			unsigned short cur = prev;
+			if (id[i] != ParticleStore::kDeadId) {
+				double q = (step[c] > 0.0) ? floor((col[i] - fMin) / step[c] + 0.5) : 0.0;
+				if (q < 0.0) q = 0.0;
+				if (q > 65535.0) q = 65535.0;
+				cur = (unsigned short)q;
+			}
+			short delta = (short)(unsigned short)(cur - prev);
+			unsigned short zz = (unsigned short)(((unsigned int)(unsigned short)delta << 1) ^ (delta < 0 ? 0xffff : 0));
+			lowPlane[i] = (unsigned char)(zz & 0xff);
+			highPlane[i] = (unsigned char)(zz >> 8);
+			prev = cur;
+		}
+	}
+
+	if (n > 0) {
+		unsigned char* planes = &raw[0] + 2 * kQuantColumns * n;
+		putFloatPlanes(&particles.mass[0], n, planes);
+		putFloatPlanes(&particles.age[0], n, planes + 4 * n);
+		putFloatPlanes(&particles.lifetime[0], n, planes + 8 * n);
+
+		// ids mostly count up by one from slot to slot
+		unsigned char* idPlanes = planes + 12 * n;
+		unsigned int prev = 0;
+		for (int i = 0; i < n; ++i) {
+			int delta = (int)(id[i] - prev);
+			unsigned int zz = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+			for (int b = 0; b < 4; ++b)
+				idPlanes[b * n + i] = (unsigned char)(zz >> (8 * b));
+			prev = id[i];
+		}
+	}
+
+	std::vector<unsigned char> packed;
+	unsigned int flags = 0;
+	if (bCompress && !raw.empty()) {
+		lzCompress(&raw[0], raw.size(), packed);
+		if (packed.size() < raw.size())
+			flags |= BAKE_CODEC_LZ;
+	}
+	const std::vector<unsigned char>& payload = (flags & BAKE_CODEC_LZ) ? packed : raw;
+
+	out.reserve(out.size() + kHeaderSize + payload.size());
+	putU32(out, (unsigned int)n);
+	putU32(out, flags);
+	putU32(out, (unsigned int)raw.size());
+	putU32(out, (unsigned int)payload.size());
+	for (int c = 0; c < kQuantColumns; ++c) {
+		putF64(out, lo[c]);
+		putF64(out, step[c]);
+	}
+	out.insert(out.end(), payload.begin(), payload.end());
+}
+
+int bakeFrameCount(const unsigned char* data, size_t size)
+{
+	if (size < kHeaderSize)
+		return -1;
+	unsigned int n;
+	memcpy(&n, data, 4);
+	return (int)n;
+}
+
+int decodeBakeFrame(const unsigned char* data, size_t size, ParticleStore& particles)
+{
+	if (size < kHeaderSize)
+		return -1;
+
+	unsigned int header[4];
+	memcpy(header, data, sizeof(header));
+	int n = (int)header[0];
+	unsigned int flags = header[1];
+	size_t rawSize = header[2];
+	size_t payloadSize = header[3];
+	if (n < 0 || rawSize != n * kBytesPerParticle || kHeaderSize + payloadSize > size)
+		return -1;
+
+	double lo[kQuantColumns];
+	double step[kQuantColumns];
+	const unsigned char* p = data + sizeof(header);
+	for (int c = 0; c < kQuantColumns; ++c) {
+		memcpy(&lo[c], p, 8);
+		memcpy(&step[c], p + 8, 8);
+		p += 16;
+	}
+
+	const unsigned char* raw = data + kHeaderSize;
+	std::vector<unsigned char> unpacked;
+	if (flags & BAKE_CODEC_LZ) {
+		unpacked.resize(rawSize);
+		if (rawSize > 0 && !lzDecompress(raw, payloadSize, &unpacked[0], rawSize))
+			return -1;
+		raw = unpacked.empty() ? NULL : &unpacked[0];
+	}
+	else if (payloadSize != rawSize) {
+		return -1;
+	}
+
+	particles.resize(n);
+	if (n == 0)
+		return 0;
+
+	std::vector<double>* columns[kQuantColumns] = {
+		&particles.px, &particles.py, &particles.pz,
+		&particles.vx, &particles.vy, &particles.vz };
+
+	for (int c = 0; c < kQuantColumns; ++c) {
+		const unsigned char* lowPlane = raw + (2 * c) * n;
+		const unsigned char* highPlane = lowPlane + n;
+		double* col = &(*columns[c])[0];
+		double fLo = lo[c], fStep = step[c];
+		unsigned short prev = 0;
+		for (int i = 0; i < n; ++i) {
+			unsigned short zz = (unsigned short)(lowPlane[i] | (highPlane[i] << 8));
+			short delta = (short)((zz >> 1) ^ -(zz & 1));
+			prev = (unsigned short)(prev + delta);
+			col[i] = fLo + prev * fStep;
+		}
+	}
+
+	const unsigned char* planes = raw + 2 * kQuantColumns * n;
+	getFloatPlanes(planes, n, &particles.mass[0]);
+	getFloatPlanes(planes + 4 * n, n, &particles.age[0]);
+	getFloatPlanes(planes + 8 * n, n, &particles.lifetime[0]);
+
+	const unsigned char* idPlanes = planes + 12 * n;
+	unsigned int prev = 0;
+	for (int i = 0; i < n; ++i) {
+		unsigned int zz = idPlanes[i] | (idPlanes[n + i] << 8) |
+			(idPlanes[2 * n + i] << 16) | ((unsigned int)idPlanes[3 * n + i] << 24);
+		prev += (zz >> 1) ^ (0u - (zz & 1));
+		particles.id[i] = prev;
+	}
+	particles.rebuildFreeList();
+	return n;
+}
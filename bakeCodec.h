@@ -0,0 +1,39 @@
+#ifndef BAKE_CODEC_H
+#define BAKE_CODEC_H
+
+#include <vector>
+#include <cstddef>
+
+class ParticleStore;
+
+// Compact encoding of one baked frame.
+//
+// Positions are quantized to 16 bits per axis inside the frame's
+// bounding box, speeds likewise inside their own per-frame range,
+// and masses, ages and lifetimes are kept as floats.  Each quantized
+// column is delta coded along the particle index (neighbouring
+// particles were spawned close together, and dead slots just repeat
+// the value before them), ids are delta coded too, and everything is
+// split into byte planes; the result can optionally be LZ
+// compressed.  The worst case quantization error over live
+// particles is extent / 131070 per axis, e.g. under a thousandth of
+// a unit for a 100 unit wide cloud.
+//
+// Frames are self-contained, so any frame decodes without its
+// neighbours.  The layout is little-endian.
+
+enum BakeCodecFlags {
+	BAKE_CODEC_LZ = 1		// payload is LZ compressed
+};
+
+// Appends the encoding of every particle in the store to out
+void encodeBakeFrame(const ParticleStore& particles, bool bCompress, std::vector<unsigned char>& out);
+
+// Decodes a frame produced by encodeBakeFrame into particles and
+// returns the particle count, or -1 if the data is malformed
+int decodeBakeFrame(const unsigned char* data, size_t size, ParticleStore& particles);
+
+// Particle count of an encoded frame without decoding it; -1 if malformed
+int bakeFrameCount(const unsigned char* data, size_t size);
+
+#endif // BAKE_CODEC_H
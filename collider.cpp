@@ -0,0 +1,483 @@
+#include "collider.h"
+#include "particle.h"
+
+#include <math.h>
+#include <algorithm>
+
+// leaves hold up to this many shapes
+static const int kLeafShapes = 2;
+// deeper than any median split hierarchy gets
+static const int kStackSize = 64;
+// a particle is put back this far outside the surface it hit
+static const double kSkin = 1e-4;
+// contacts resolved per particle per step; more only happen in
+// corners, where the rest are left for the next step
+static const int kMaxContacts = 4;
+// most points a path is tested at against one shape
+static const int kMaxSamples = 64;
+
+static inline void transformPoint(const double m[12], const double p[3], double out[3])
+{
+	for (int r = 0; r < 3; ++r)
+		out[r] = m[4 * r] * p[0] + m[4 * r + 1] * p[1] + m[4 * r + 2] * p[2] + m[4 * r + 3];
+}
+
+static inline void toAffine(const Mat4d& m, double out[12])
+{
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 4; ++c)
+			out[4 * r + c] = m[r][c];
+}
+
+ColliderSet::ColliderSet() :
+	m_iNext(0),
+	m_bChanged(false),
+	m_iRebuilds(0)
+{
+}
+
+void ColliderSet::beginFrame()
+{
+	m_iNext = 0;
+}
+
+void ColliderSet::addBox(const Mat4d& toWorld, double x, double y, double z)
+{
+	add(COLLIDER_BOX, toWorld, x, y, z);
+}
+
+void ColliderSet::addCylinder(const Mat4d& toWorld, double h, double r1, double r2)
+{
+	add(COLLIDER_CYLINDER, toWorld, h, r1, r2);
+}
+
+void ColliderSet::addSphere(const Mat4d& toWorld, double r)
+{
+	add(COLLIDER_SPHERE, toWorld, r, r, r);
+}
+
+// whether a shape of these dimensions has an inside to bounce off
+static bool solid(ColliderType type, double a, double b, double c)
+{
+	switch (type)
+	{
+	case COLLIDER_BOX:
+		return a > 0 && b > 0 && c > 0;
+	case COLLIDER_CYLINDER:
+		// a cone is fine, a flat or inside out one isn't
+		return a > 0 && b >= 0 && c >= 0 && b + c > 0;
+	case COLLIDER_SPHERE:
+		return a > 0;
+	default:
+		return false;
+	}
+}
+
+void ColliderSet::add(ColliderType type, const Mat4d& toWorld, double a, double b, double c)
+{
+	// Flat shapes are skipped: a zero height cylinder would divide by
+	// zero finding its sides, and none of them can be crossed anyway.
+	if (!solid(type, a, b, c))
+		return;
+
+	if (m_iNext == size())
+	{
+		m_shapes.push_back(Shape());
+		m_bChanged = true;
+	}
+	else if (m_shapes[m_iNext].type != type)
+		m_bChanged = true;
+	Shape& s = m_shapes[m_iNext++];
+
+	s.type = type;
+	s.dim[0] = a; s.dim[1] = b; s.dim[2] = c;
+	toAffine(toWorld, s.toWorld);
+	toAffine(toWorld.inverse(), s.toLocal);
+
+	// local bounds, whose corners bound the shape once transformed
+	double lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+	switch (type)
+	{
+	case COLLIDER_BOX:
+		lo[0] = lo[1] = lo[2] = 0;
+		hi[0] = a; hi[1] = b; hi[2] = c;
+		s.thickness = std::min(a, std::min(b, c));
+		break;
+	case COLLIDER_CYLINDER:
+	{
+		double r = std::max(b, c);
+		lo[0] = lo[1] = -r; lo[2] = 0;
+		hi[0] = hi[1] = r; hi[2] = a;
+		// a cone's tip is thinner, but nothing can cross it unseen
+		// that doesn't also cross the wider part
+		s.thickness = std::min(a, b + c);
+		break;
+	}
+	case COLLIDER_SPHERE:
+		lo[0] = lo[1] = lo[2] = -a;
+		hi[0] = hi[1] = hi[2] = a;
+		s.thickness = 2 * a;
+		break;
+	default:
+		s.thickness = 0;
+		break;
+	}
+
+	for (int k = 0; k < 8; ++k)
+	{
+		double corner[3] = { (k & 1) ? hi[0] : lo[0], (k & 2) ? hi[1] : lo[1], (k & 4) ? hi[2] : lo[2] };
+		double w[3];
+		transformPoint(s.toWorld, corner, w);
+		for (int i = 0; i < 3; ++i)
+		{
+			if (k == 0 || w[i] < s.lo[i]) s.lo[i] = w[i];
+			if (k == 0 || w[i] > s.hi[i]) s.hi[i] = w[i];
+		}
+	}
+}
+
+void ColliderSet::endFrame()
+{
+	if (m_iNext != size())
+	{
+		m_shapes.resize(m_iNext);
+		m_bChanged = true;
+	}
+
+	if (m_bChanged)
+		build();
+	else
+		refit();
+	m_bChanged = false;
+}
+
+void ColliderSet::clear()
+{
+	m_shapes.clear();
+	m_order.clear();
+	m_nodes.clear();
+	m_iNext = 0;
+	m_bChanged = false;
+}
+
+void ColliderSet::build()
+{
+	m_nodes.clear();
+	m_order.resize(m_shapes.size());
+	for (int i = 0; i < size(); ++i)
+		m_order[i] = i;
+	if (!m_shapes.empty())
+		buildNode(0, size());
+	refit();
+	++m_iRebuilds;
+}
+
+// Splits the shapes m_order[first, first + count) at the median of
+// their centres along the widest spread; children always land after
+// their parent, so refit() can go back to front
+int ColliderSet::buildNode(int first, int count)
+{
+	int iNode = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+	m_nodes[iNode].left = m_nodes[iNode].right = -1;
+	m_nodes[iNode].first = first;
+	m_nodes[iNode].count = count;
+
+	if (count > kLeafShapes)
+	{
+		double lo[3], hi[3];
+		for (int i = 0; i < count; ++i)
+		{
+			const Shape& s = m_shapes[m_order[first + i]];
+			for (int k = 0; k < 3; ++k)
+			{
+				double c = s.lo[k] + s.hi[k];
+				if (i == 0 || c < lo[k]) lo[k] = c;
+				if (i == 0 || c > hi[k]) hi[k] = c;
+			}
+		}
+		int axis = 0;
+		for (int k = 1; k < 3; ++k)
+			if (hi[k] - lo[k] > hi[axis] - lo[axis])
+				axis = k;
+
+		int half = count / 2;
+		const std::vector<Shape>& shapes = m_shapes;
+		std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+			[&shapes, axis](int a, int b)
+		{
+			double ca = shapes[a].lo[axis] + shapes[a].hi[axis];
+			double cb = shapes[b].lo[axis] + shapes[b].hi[axis];
+			return ca < cb || (ca == cb && a < b);
+		});
+
+		int iLeft = buildNode(first, half);
+		int iRight = buildNode(first + half, count - half);
+		Node& node = m_nodes[iNode];
+		node.left = iLeft;
+		node.right = iRight;
+		node.count = 0;
+	}
+	return iNode;
+}
+
+void ColliderSet::refit()
+{
+	for (int i = (int)m_nodes.size() - 1; i >= 0; --i)
+	{
+		Node& node = m_nodes[i];
+		if (node.count > 0)
+		{
+			for (int j = 0; j < node.count; ++j)
+			{
+				const Shape& s = m_shapes[m_order[node.first + j]];
+				for (int k = 0; k < 3; ++k)
+				{
+					if (j == 0 || s.lo[k] < node.lo[k]) node.lo[k] = s.lo[k];
+					if (j == 0 || s.hi[k] > node.hi[k]) node.hi[k] = s.hi[k];
+				}
+			}
+		}
+		else
+		{
+			const Node& l = m_nodes[node.left];
+			const Node& r = m_nodes[node.right];
+			for (int k = 0; k < 3; ++k)
+			{
+				node.lo[k] = std::min(l.lo[k], r.lo[k]);
+				node.hi[k] = std::max(l.hi[k], r.hi[k]);
+			}
+		}
+	}
+}
+
+/****************
+ * Shape queries
+ ****************/
+
+// q is in the shape's local frame
+static bool inside(ColliderType type, const double dim[3], const double q[3])
+{
+	switch (type)
+	{
+	case COLLIDER_BOX:
+		return q[0] >= 0 && q[0] <= dim[0] && q[1] >= 0 && q[1] <= dim[1] && q[2] >= 0 && q[2] <= dim[2];
+	case COLLIDER_CYLINDER:
+	{
+		if (q[2] < 0 || q[2] > dim[0])
+			return false;
+		double r = dim[1] + (dim[2] - dim[1]) * q[2] / dim[0];
+		return q[0] * q[0] + q[1] * q[1] <= r * r;
+	}
+	case COLLIDER_SPHERE:
+		return q[0] * q[0] + q[1] * q[1] + q[2] * q[2] <= dim[0] * dim[0];
+	}
+	return false;
+}
+
+// The point of the surface nearest q, which is inside the shape, and
+// the outward normal there, all in the local frame
+static void nearestSurface(ColliderType type, const double dim[3], const double q[3], double out[3], double n[3])
+{
+	out[0] = q[0]; out[1] = q[1]; out[2] = q[2];
+	n[0] = n[1] = n[2] = 0;
+
+	switch (type)
+	{
+	case COLLIDER_BOX:
+	{
+		int iAxis = 0;
+		bool bHigh = false;
+		double best = q[0];
+		for (int k = 0; k < 3; ++k)
+		{
+			if (q[k] < best) { best = q[k]; iAxis = k; bHigh = false; }
+			if (dim[k] - q[k] < best) { best = dim[k] - q[k]; iAxis = k; bHigh = true; }
+		}
+		out[iAxis] = bHigh ? dim[iAxis] : 0;
+		n[iAxis] = bHigh ? 1 : -1;
+		break;
+	}
+	case COLLIDER_CYLINDER:
+	{
+		double h = dim[0];
+		double slope = (dim[2] - dim[1]) / h;
+		double rho = sqrt(q[0] * q[0] + q[1] * q[1]);
+		double ux = 1, uy = 0;
+		if (rho > 0)
+		{
+			ux = q[0] / rho;
+			uy = q[1] / rho;
+		}
+		double norm = 1.0 / sqrt(1 + slope * slope);
+		double side = (dim[1] + slope * q[2] - rho) * norm;
+
+		if (q[2] <= side && q[2] <= h - q[2])
+		{
+			out[2] = 0;
+			n[2] = -1;
+		}
+		else if (h - q[2] <= side)
+		{
+			out[2] = h;
+			n[2] = 1;
+		}
+		else
+		{
+			n[0] = ux * norm;
+			n[1] = uy * norm;
+			n[2] = -slope * norm;
+			for (int k = 0; k < 3; ++k)
+				out[k] = q[k] + n[k] * side;
+		}
+		break;
+	}
+	case COLLIDER_SPHERE:
+	{
+		double len = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+		if (len > 0)
+		{
+			n[0] = q[0] / len; n[1] = q[1] / len; n[2] = q[2] / len;
+		}
+		else
+			n[1] = 1;
+		for (int k = 0; k < 3; ++k)
+			out[k] = n[k] * dim[0];
+		break;
+	}
+	}
+}
+
+// Earliest point of the path p0 -> p1 inside any shape, as the shape
+// and the fraction t of the way along; false if there is none
+bool ColliderSet::hit(const double p0[3], const double p1[3], int& iShape, double& t) const
+{
+	double lo[3], hi[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		lo[k] = std::min(p0[k], p1[k]);
+		hi[k] = std::max(p0[k], p1[k]);
+	}
+
+	iShape = -1;
+	t = 2;
+	int stack[kStackSize];
+	int iTop = 0;
+	stack[iTop++] = 0;
+	while (iTop > 0)
+	{
+		const Node& node = m_nodes[stack[--iTop]];
+		if (node.lo[0] > hi[0] || node.hi[0] < lo[0] ||
+			node.lo[1] > hi[1] || node.hi[1] < lo[1] ||
+			node.lo[2] > hi[2] || node.hi[2] < lo[2])
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[iTop++] = node.right;
+			stack[iTop++] = node.left;
+			continue;
+		}
+
+		for (int j = 0; j < node.count; ++j)
+		{
+			int i = m_order[node.first + j];
+			const Shape& s = m_shapes[i];
+			if (s.lo[0] > hi[0] || s.hi[0] < lo[0] ||
+				s.lo[1] > hi[1] || s.hi[1] < lo[1] ||
+				s.lo[2] > hi[2] || s.hi[2] < lo[2])
+				continue;
+
+			double a[3], b[3];
+			transformPoint(s.toLocal, p0, a);
+			transformPoint(s.toLocal, p1, b);
+			double dx = b[0] - a[0], dy = b[1] - a[1], dz = b[2] - a[2];
+			double len = sqrt(dx * dx + dy * dy + dz * dz);
+
+			// samples half the shape's thickness apart can't skip over
+			// it, and the first inside is nearer the side entered
+			int n = 1;
+			if (s.thickness > 0)
+				n = std::min(kMaxSamples, std::max(1, (int)ceil(len / (0.5 * s.thickness))));
+			for (int k = 1; k <= n; ++k)
+			{
+				double f = (double)k / n;
+				if (f > t || (f == t && i > iShape))
+					break;
+				double q[3] = { a[0] + dx * f, a[1] + dy * f, a[2] + dz * f };
+				if (inside(s.type, s.dim, q))
+				{
+					iShape = i;
+					t = f;
+					break;
+				}
+			}
+		}
+	}
+	return iShape >= 0;
+}
+
+int ColliderSet::collide(ParticleStore& particles, int begin, int end, double h,
+						 double restitution, double friction) const
+{
+	if (m_nodes.empty())
+		return 0;
+
+	int iContacts = 0;
+	for (int i = begin; i < end; ++i)
+	{
+		if (!particles.alive(i))
+			continue;
+
+		double p1[3] = { particles.px[i], particles.py[i], particles.pz[i] };
+		double v[3] = { particles.vx[i], particles.vy[i], particles.vz[i] };
+		double p0[3] = { p1[0] - v[0] * h, p1[1] - v[1] * h, p1[2] - v[2] * h };
+
+		int iShape;
+		double t;
+		for (int c = 0; c < kMaxContacts && hit(p0, p1, iShape, t); ++c)
+		{
+			const Shape& s = m_shapes[iShape];
+			double a[3], b[3], q[3];
+			transformPoint(s.toLocal, p0, a);
+			transformPoint(s.toLocal, p1, b);
+			for (int k = 0; k < 3; ++k)
+				q[k] = a[k] + (b[k] - a[k]) * t;
+
+			double surf[3], nLocal[3], p[3];
+			nearestSurface(s.type, s.dim, q, surf, nLocal);
+			transformPoint(s.toWorld, surf, p);
+
+			// normals go through the inverse transpose
+			double nw[3];
+			for (int k = 0; k < 3; ++k)
+				nw[k] = s.toLocal[k] * nLocal[0] + s.toLocal[4 + k] * nLocal[1] + s.toLocal[8 + k] * nLocal[2];
+			double len = sqrt(nw[0] * nw[0] + nw[1] * nw[1] + nw[2] * nw[2]);
+			for (int k = 0; k < 3; ++k)
+				nw[k] /= len;
+
+			for (int k = 0; k < 3; ++k)
+				p1[k] = p[k] + nw[k] * kSkin;
+
+			double vn = v[0] * nw[0] + v[1] * nw[1] + v[2] * nw[2];
+			if (vn < 0)
+			{
+				double vt[3] = { v[0] - vn * nw[0], v[1] - vn * nw[1], v[2] - vn * nw[2] };
+				double vtLen = sqrt(vt[0] * vt[0] + vt[1] * vt[1] + vt[2] * vt[2]);
+				double keep = 0;
+				if (vtLen > 0)
+					keep = std::max(0.0, 1.0 - friction * (1 + restitution) * -vn / vtLen);
+				for (int k = 0; k < 3; ++k)
+					v[k] = vt[k] * keep - restitution * vn * nw[k];
+			}
+
+			// anything else it's in is only checked where it ends up
+			p0[0] = p1[0]; p0[1] = p1[1]; p0[2] = p1[2];
+			++iContacts;
+		}
+
+		particles.px[i] = p1[0]; particles.py[i] = p1[1]; particles.pz[i] = p1[2];
+		particles.vx[i] = v[0]; particles.vy[i] = v[1]; particles.vz[i] = v[2];
+	}
+	return iContacts;
+}
@@ -0,0 +1,83 @@
+#ifndef COLLIDER_H
+#define COLLIDER_H
+
+#include "mat.h"
+#include <vector>
+
+class ParticleStore;
+
+enum ColliderType {
+	COLLIDER_BOX,			// drawBox: [0,x] * [0,y] * [0,z]
+	COLLIDER_CYLINDER,		// drawCylinder: along z from 0 (radius r1) to h (radius r2)
+	COLLIDER_SPHERE,		// drawSphere: radius r about the origin
+};
+
+// The solid shapes of the scene, for particles to bounce off.  Each
+// shape is the primitive modelerdraw draws, placed in the world by
+// the modelview it was drawn with.
+//
+// The shapes are re-recorded every frame between beginFrame() and
+// endFrame(), in drawing order.  As long as the same kinds of shape
+// come in the same order (the robot is drawn the same way whatever
+// its joint angles) they keep their slots, and the bounding volume
+// hierarchy over them keeps its shape and only has its boxes refit
+// to the new transforms.  It is rebuilt when the list changes.
+// Shapes with no volume (a zero height cylinder, a box with a zero
+// or negative side) aren't recorded.
+class ColliderSet {
+public:
+	ColliderSet();
+
+	void beginFrame();
+	void addBox(const Mat4d& toWorld, double x, double y, double z);
+	void addCylinder(const Mat4d& toWorld, double h, double r1, double r2);
+	void addSphere(const Mat4d& toWorld, double r);
+	void endFrame();
+	void clear();
+
+	int size() const { return (int)m_shapes.size(); }
+	bool empty() const { return m_shapes.empty(); }
+	int nodeCount() const { return (int)m_nodes.size(); }
+	// times the hierarchy was built from scratch rather than refit
+	int rebuildCount() const { return m_iRebuilds; }
+
+	// Moves every live particle in [begin, end) that went into a shape
+	// during the last step of length h back out through the surface
+	// it crossed, and bounces it: the speed along the surface normal
+	// is reversed and scaled by restitution, the speed along the
+	// surface loses up to friction times the normal impulse (Coulomb
+	// friction).  The path of the step is taken to be p - v h to p,
+	// and is followed finely enough that thin shapes such as the floor
+	// can't be stepped over.  Returns how many contacts were resolved.
+	int collide(ParticleStore& particles, int begin, int end, double h,
+				double restitution, double friction) const;
+
+private:
+	struct Shape {
+		ColliderType type;
+		double dim[3];
+		double thickness;					// narrowest local extent
+		double toWorld[12], toLocal[12];	// affine, row major 3x4
+		double lo[3], hi[3];				// world bounds
+	};
+	struct Node {
+		double lo[3], hi[3];
+		int left, right;					// children, after the node in the array
+		int first, count;					// shapes of a leaf; count 0 inside
+	};
+
+	void add(ColliderType type, const Mat4d& toWorld, double a, double b, double c);
+	void build();
+	int buildNode(int first, int count);
+	void refit();
+	bool hit(const double p0[3], const double p1[3], int& iShape, double& t) const;
+
+	std::vector<Shape> m_shapes;
+	std::vector<int> m_order;				// shape indices grouped by leaf
+	std::vector<Node> m_nodes;
+	int m_iNext;							// shapes recorded so far this frame
+	bool m_bChanged;
+	int m_iRebuilds;
+};
+
+#endif // COLLIDER_H
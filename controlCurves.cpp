@@ -0,0 +1,73 @@
+#include "controlCurves.h"
+#include "curveevaluator.h"
+#include "linearcurveevaluator.h"
+#include "Beziercurveevaluator.h"
+#include "Bsplinecurveevaluator.h"
+#include "CatmullRomcurveevaluator.h"
+#include "C2InterpolatingCurveEvaluator.h"
+
+#include <fstream>
+
+// Evaluators keep no state of their own, so one of each type serves
+// every loaded curve
+static const CurveEvaluator* evaluatorOfType(int iType)
+{
+	static LinearCurveEvaluator linear;
+	static BsplineCurveEvaluator bspline;
+	static BezierCurveEvaluator bezier;
+	static CatmullRomCurveEvaluator catmullRom;
+	static C2InterpolatingCurveEvaluator c2Interpolating;
+
+	switch (iType)
+	{
+	case CURVE_TYPE_LINEAR: return &linear;
+	case CURVE_TYPE_BSPLINE: return &bspline;
+	case CURVE_TYPE_BEZIER: return &bezier;
+	case CURVE_TYPE_CATMULLROM: return &catmullRom;
+	case CURVE_TYPE_C2INTERPOLATING: return &c2Interpolating;
+	}
+	return NULL;
+}
+
+double ControlCurves::value(int iControl, float t) const
+{
+	if (iControl < 0 || iControl >= (int)m_curves.size())
+		return 0.0;
+	return m_curves[iControl].evaluateCurveAt(t);
+}
+
+float ControlCurves::load(const char* szFileName, int iControlCount)
+{
+	m_curves.clear();
+
+	std::ifstream ifsFile(szFileName, std::ios::in);
+	if (ifsFile.fail())
+		return 0.0f;
+
+	float fEndTime = 0.0f;
+	int iCurveCount = 0;
+	ifsFile >> fEndTime >> iCurveCount;
+	if (fEndTime <= 0.0f || iCurveCount != iControlCount)
+		return 0.0f;
+
+	for (int i = 0; i < iCurveCount; ++i)
+	{
+		int iType = -1;
+		ifsFile >> iType;
+		const CurveEvaluator* pceEvaluator = evaluatorOfType(iType);
+		if (!pceEvaluator)
+			break;
+
+		Curve crv;
+		crv.fromStream(ifsFile);
+		crv.setEvaluator(pceEvaluator);
+		m_curves.push_back(crv);
+	}
+
+	if (ifsFile.fail() || (int)m_curves.size() != iCurveCount)
+	{
+		m_curves.clear();
+		return 0.0f;
+	}
+	return fEndTime;
+}
@@ -0,0 +1,33 @@
+#ifndef CONTROL_CURVES_H
+#define CONTROL_CURVES_H
+
+#include <vector>
+
+#include "curve.h"
+
+// The value of every control over time: a copy of the animation
+// curves, one per control in SampleModelControls order.  Whatever
+// simulates ahead of the playhead reads the controls off a copy like
+// this rather than off the UI, which may be editing its curves (or
+// showing another time) meanwhile.
+class ControlCurves {
+public:
+	void clear() { m_curves.clear(); }
+	// copies the curve, evaluator and all
+	void add(const Curve& curve) { m_curves.push_back(curve); }
+	int size() const { return (int)m_curves.size(); }
+
+	// control iControl at time t; 0 for a control with no curve
+	double value(int iControl, float t) const;
+
+	// Replaces the curves with those of an .ani script, read as
+	// GraphWidget::loadScript does.  Returns the script's end time,
+	// or 0 (leaving no curves) if it can't be read or has other than
+	// iControlCount curves.
+	float load(const char* szFileName, int iControlCount);
+
+private:
+	std::vector<Curve> m_curves;
+};
+
+#endif // CONTROL_CURVES_H
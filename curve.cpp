@@ -1,4 +1,4 @@
-#include "Curve.h"
+#include "curve.h"
 
 #include <algorithm>
 #include <functional>
@@ -6,14 +6,11 @@
 #include <assert.h>
 #endif // _DEBUG
 #include <math.h>
-#ifdef WIN32
-#include <windows.h>
-#endif // WIN32
-#include <GL/gl.h>
 #include <float.h>
 
-#include "Curve.h"
-#include "CurveEvaluator.h"
+#include "curve.h"
+#include "curveevaluator.h"
+#include "frameTimings.h"
 
 float Curve::s_fCtrlPtXEpsilon = 0.0001f;
 
@@ -23,6 +20,19 @@ Curve::Curve() :
 	m_bAdaptive(false),
 	m_dTension(0.5),
 	m_bDirty(true),
+	m_fStartY(0.0f),
+	m_fEndY(0.0f),
+	m_iMovedFirst(-1),
+	m_iMovedLast(-1),
+	m_iStaleFirst(-1),
+	m_iStaleLast(-1),
+	m_iUnjoinedFirst(-1),
+	m_iUnjoinedLast(-1),
+	m_iUntabledFirst(-1),
+	m_iUntabledLast(-1),
+	m_bPointsDirty(true),
+	m_bSegmentsDirty(true),
+	m_uSegmentsRevision(0),
 	m_fMaxX(1.0f)
 {
 	init();
@@ -34,6 +44,19 @@ Curve::Curve(const float fMaxX, const Point& point) :
 	m_bAdaptive(false),
 	m_dTension(0.5),
 	m_bDirty(true),
+	m_fStartY(0.0f),
+	m_fEndY(0.0f),
+	m_iMovedFirst(-1),
+	m_iMovedLast(-1),
+	m_iStaleFirst(-1),
+	m_iStaleLast(-1),
+	m_iUnjoinedFirst(-1),
+	m_iUnjoinedLast(-1),
+	m_iUntabledFirst(-1),
+	m_iUntabledLast(-1),
+	m_bPointsDirty(true),
+	m_bSegmentsDirty(true),
+	m_uSegmentsRevision(0),
 	m_fMaxX(fMaxX)
 {
 	addControlPoint(point);
@@ -45,6 +68,19 @@ Curve::Curve(const float fMaxX, const float fStartYValue) :
 	m_bAdaptive(false),
 	m_dTension(0.5),
 	m_bDirty(true),
+	m_fStartY(0.0f),
+	m_fEndY(0.0f),
+	m_iMovedFirst(-1),
+	m_iMovedLast(-1),
+	m_iStaleFirst(-1),
+	m_iStaleLast(-1),
+	m_iUnjoinedFirst(-1),
+	m_iUnjoinedLast(-1),
+	m_iUntabledFirst(-1),
+	m_iUntabledLast(-1),
+	m_bPointsDirty(true),
+	m_bSegmentsDirty(true),
+	m_uSegmentsRevision(0),
 	m_fMaxX(fMaxX)
 {
 	init(fStartYValue);
@@ -69,7 +105,20 @@ void Curve::maxX(const float fNewMaxX)
 	m_bDirty = true;
 }
 
-Curve::Curve(std::istream& isInputStream)
+Curve::Curve(std::istream& isInputStream) :
+	m_fStartY(0.0f),
+	m_fEndY(0.0f),
+	m_iMovedFirst(-1),
+	m_iMovedLast(-1),
+	m_iStaleFirst(-1),
+	m_iStaleLast(-1),
+	m_iUnjoinedFirst(-1),
+	m_iUnjoinedLast(-1),
+	m_iUntabledFirst(-1),
+	m_iUntabledLast(-1),
+	m_bPointsDirty(true),
+	m_bSegmentsDirty(true),
+	m_uSegmentsRevision(0)
 {
 	fromStream(isInputStream);
 }
@@ -140,56 +189,23 @@ void Curve::tension(const double dTension)
 
 float Curve::evaluateCurveAt(const float x) const
 {
-	reevaluate();
-	
-	float value = 0.0f;
-
-	if (m_ptvEvaluatedCurvePts.size() == 1)
-		return m_ptvEvaluatedCurvePts[0].y;
-
-	if (m_ptvEvaluatedCurvePts.size() > 1) {
-		std::vector<Point>::iterator first_point = m_ptvEvaluatedCurvePts.begin();
-		std::vector<Point>::iterator last_point = m_ptvEvaluatedCurvePts.end() - 1;
-
-		bool evaluate_point_to_left_of_range = (first_point->x > x);
-		bool evaluate_point_to_right_of_range = (last_point->x < x);
+	reevaluateSegments();
 
-		if (evaluate_point_to_left_of_range) {
-			value = first_point->y;
-		}
-		else if (evaluate_point_to_right_of_range) {
-			value = last_point->y;
-		}
-		else {
-			std::vector<Point>::iterator point_one_iterator = first_point;
-
-			while ((point_one_iterator + 1)->x < x) {
-				++point_one_iterator;
-#ifdef _DEBUG
-				assert(point_one_iterator != last_point);
-#endif // _DEBUG
-			}
+	return m_segments.valueAt(x);
+}
 
-			std::vector<Point>::iterator point_two_iterator = point_one_iterator + 1;
-			
-#ifdef _DEBUG
-			assert(point_one_iterator != m_ptvEvaluatedCurvePts.end());
-			assert(point_two_iterator != m_ptvEvaluatedCurvePts.end());
-#endif // _DEBUG
+const CurveSegmentTable& Curve::segments() const
+{
+	reevaluateSegments();
 
-			Point point_one = *point_one_iterator;
-			Point point_two = *point_two_iterator;
+	return m_segments;
+}
 
-			if (point_one.x == point_two.x)
-				value = point_one.y;
-			else {
-				float slope = (point_two.y - point_one.y) / (point_two.x - point_one.x);
-				value = (x - point_one.x) * slope + point_one.y;
-			}
-		}
-	}
+unsigned int Curve::segmentsRevision() const
+{
+	reevaluateSegments();
 
-	return value;
+	return m_uSegmentsRevision;
 }
 
 void Curve::scaleX(const float fScale)
@@ -310,9 +326,9 @@ void Curve::moveControlPoint(const int iCtrlPt, const Point& ptNewPt)
 			if (m_ptvCtrlPts[iCtrlPt].x > m_ptvCtrlPts[iCtrlPt + 1].x - s_fCtrlPtXEpsilon)
 				m_ptvCtrlPts[iCtrlPt].x = m_ptvCtrlPts[iCtrlPt + 1].x - s_fCtrlPtXEpsilon;
 		}
-	}
 
-	m_bDirty = true;
+		controlPointsMoved(iCtrlPt, iCtrlPt);
+	}
 }
 
 void Curve::moveControlPoints(const std::vector<int>& ivCtrlPts, const Point& ptOffset,
@@ -369,92 +385,133 @@ void Curve::moveControlPoints(const std::vector<int>& ivCtrlPts, const Point& pt
 		m_ptvCtrlPts[iCtrlPt].y += ptActualOffset.y;
 	}
 
-	m_bDirty = true;
+	if (!ivCtrlPts.empty()) {
+		controlPointsMoved(*std::min_element(ivCtrlPts.begin(), ivCtrlPts.end()),
+			*std::max_element(ivCtrlPts.begin(), ivCtrlPts.end()));
+	}
 }
 
-void Curve::drawCurve() const
+void Curve::sortControlPoints() const
 {
-	reevaluate();
-
-	drawEvaluatedCurveSegments();
+	std::sort(m_ptvCtrlPts.begin(),
+		m_ptvCtrlPts.end(),
+		PointSmallerXCompare());
 }
 
-void Curve::drawEvaluatedCurveSegments() const
+// widens the range first to last, -1 while empty, to take in iFirst to iLast
+static void widen(int& first, int& last, int iFirst, int iLast)
 {
-	reevaluate();
-
-	glBegin(GL_LINE_STRIP);
-
-		for (std::vector<Point>::const_iterator it = m_ptvEvaluatedCurvePts.begin(); 
-			it != m_ptvEvaluatedCurvePts.end(); 
-			++it) {
-			glVertex2f(it->x, it->y);
-		}
-
-	glEnd();
+	if (first < 0) {
+		first = iFirst;
+		last = iLast;
+	}
+	else {
+		first = std::min(first, iFirst);
+		last = std::max(last, iLast);
+	}
 }
 
-void Curve::drawControlPoint(int iCtrlPt) const
+void Curve::controlPointsMoved(int iFirst, int iLast)
 {
-	reevaluate();
-
-	double fPointSize;
-	glGetDoublev(GL_POINT_SIZE, &fPointSize);
-	glPointSize(7.0);
-
-	glColor3d(1,0,0);
-	glBegin(GL_POINTS);
-		glVertex2f(m_ptvCtrlPts[iCtrlPt].x, m_ptvCtrlPts[iCtrlPt].y);
-	glEnd();
-
-	glPointSize(fPointSize);
+	widen(m_iMovedFirst, m_iMovedLast, iFirst, iLast);
 }
 
-void Curve::drawControlPoints() const
+void Curve::updatePieces() const
 {
-	reevaluate();
+	if (!m_pceEvaluator || (!m_bDirty && m_iMovedFirst < 0))
+		return;
+
+	ScopedTiming timing(TIMING_CURVES);
+
+	int iFirst = 0, iLast = -1;
+	if (m_bDirty) {
+		int iPieces = m_ptvCtrlPts.empty() ? 0 : m_pceEvaluator->pieceCount(m_ptvCtrlPts, m_bWrap);
+		m_pieces.resize(iPieces);
+		m_pieceSamples.resize(iPieces);
+		iLast = iPieces - 1;
+		m_iStaleFirst = m_iUnjoinedFirst = m_iUntabledFirst = -1;
+		if (iFirst <= iLast)
+			m_pceEvaluator->evaluatePieces(m_ptvCtrlPts, m_pieces, iFirst, iLast, m_fMaxX, m_bWrap, m_dTension);
+	}
+	else {
+		m_pceEvaluator->affectedPieces(m_ptvCtrlPts, m_iMovedFirst, m_iMovedLast, m_bWrap, iFirst, iLast);
+		if (iFirst <= iLast)
+			m_pceEvaluator->reevaluatePieces(m_ptvCtrlPts, m_pieces, iFirst, iLast, m_fMaxX, m_bWrap, m_dTension);
+	}
 
-	double fPointSize;
-	glGetDoublev(GL_POINT_SIZE, &fPointSize);
-	glPointSize(7.0);
+	if (iFirst <= iLast) {
 
-	glColor3d(1,1,1);
-	glBegin(GL_POINTS);
-		for (std::vector<Point>::const_iterator kit = m_ptvCtrlPts.begin(); 
-			kit != m_ptvCtrlPts.end(); 
-			++kit) {
-			glVertex2f(kit->x, kit->y);
+		widen(m_iStaleFirst, m_iStaleLast, iFirst, iLast);
+		widen(m_iUnjoinedFirst, m_iUnjoinedLast, iFirst, iLast);
+		widen(m_iUntabledFirst, m_iUntabledLast, iFirst, iLast);
+	}
+	if (!m_ptvCtrlPts.empty()) {
+		// the values held at the ends are in the points and the table
+		// of pieces far from those that changed
+		float fStartY = m_fStartY, fEndY = m_fEndY;
+		m_pceEvaluator->endValues(m_ptvCtrlPts, m_fMaxX, m_bWrap, m_fStartY, m_fEndY);
+		if ((m_fStartY != fStartY || m_fEndY != fEndY) && !m_pieces.empty()) {
+			widen(m_iUnjoinedFirst, m_iUnjoinedLast, 0, (int)m_pieces.size() - 1);
+			widen(m_iUntabledFirst, m_iUntabledLast, 0, (int)m_pieces.size() - 1);
 		}
-	glEnd();
+	}
 
-	glPointSize(fPointSize);
+	m_bDirty = false;
+	m_iMovedFirst = m_iMovedLast = -1;
+	m_bPointsDirty = m_bSegmentsDirty = true;
 }
 
-void Curve::sortControlPoints() const
+void Curve::reevaluate() const
 {
-	std::sort(m_ptvCtrlPts.begin(),
-		m_ptvCtrlPts.end(),
-		PointSmallerXCompare());
+	if (!m_pceEvaluator)
+		return;
+	updatePieces();
+	if (!m_bPointsDirty)
+		return;
+
+	ScopedTiming timing(TIMING_CURVES);
+
+	// only the pieces that changed are drawn through new points
+	for (int i = m_iStaleFirst; i >= 0 && i <= m_iStaleLast; ++i)
+		CurveEvaluator::tessellate(m_pieces[i], m_pieceSamples[i], m_bAdaptive);
+	m_iStaleFirst = m_iStaleLast = -1;
+
+	// all the pieces changed, or the new points reach those of
+	// pieces that didn't: the curve is joined whole
+	const int iPieces = (int)m_pieces.size();
+	if (m_iUnjoinedFirst < 0 || (m_iUnjoinedFirst == 0 && m_iUnjoinedLast == iPieces - 1) ||
+		!CurveEvaluator::rejoinPieces(m_pieceSamples, m_ptvEvaluatedCurvePts, m_pieceStarts,
+			m_iUnjoinedFirst, m_iUnjoinedLast, m_fMaxX, m_bWrap, m_fStartY)) {
+		CurveEvaluator::joinPieces(m_pieceSamples, m_ptvEvaluatedCurvePts, m_pieceStarts,
+			m_fMaxX, m_bWrap, m_fStartY, m_fEndY);
+	}
+	m_iUnjoinedFirst = m_iUnjoinedLast = -1;
+
+	m_bPointsDirty = false;
 }
 
-void Curve::reevaluate() const
+void Curve::reevaluateSegments() const
 {
-	if (m_bDirty) {
-		if (m_pceEvaluator) {
-			m_pceEvaluator->evaluateCurve(m_ptvCtrlPts, 
-				m_ptvEvaluatedCurvePts, 
-				m_fMaxX, 
-				m_bWrap,
-				m_bAdaptive,
-				m_dTension);
-
-			std::sort(m_ptvEvaluatedCurvePts.begin(),
-				m_ptvEvaluatedCurvePts.end(),
-				PointSmallerXCompare());
-
-			m_bDirty = false;
-		}
+	if (!m_pceEvaluator)
+		return;
+	updatePieces();
+	if (!m_bSegmentsDirty)
+		return;
+
+	ScopedTiming timing(TIMING_CURVES);
+
+	const int iPieces = (int)m_pieces.size();
+	if (m_iUntabledFirst < 0 || (m_iUntabledFirst == 0 && m_iUntabledLast == iPieces - 1) ||
+		!m_segments.replace(m_pieces, m_iUntabledFirst, m_iUntabledLast, m_fMaxX, m_bWrap, m_fStartY, m_fEndY)) {
+		m_segments.clear();
+		for (int i = 0; i < iPieces; ++i)
+			m_segments.add(m_pieces[i]);
+		m_segments.finish(m_fMaxX, m_bWrap, m_fStartY, m_fEndY);
 	}
+	m_iUntabledFirst = m_iUntabledLast = -1;
+
+	m_bSegmentsDirty = false;
+	++m_uSegmentsRevision;
 }
 
 void Curve::invalidate() const
@@ -7,7 +7,8 @@
 #include <iostream>
 #include <string>
 
-#include "Point.h"
+#include "point.h"
+#include "curveSegments.h"
 
 class CurveEvaluator;
 
@@ -25,6 +26,10 @@ public:
 	void maxX(const float fNewMaxX);
 	void setEvaluator(const CurveEvaluator* pceEvaluator) { m_pceEvaluator = pceEvaluator; }
 	float evaluateCurveAt(const float x) const;
+	// the pieces evaluateCurveAt() reads, brought up to date, and a
+	// count that changes whenever they do
+	const CurveSegmentTable& segments(void) const;
+	unsigned int segmentsRevision(void) const;
 	void scaleX(const float fScale);
 	void addControlPoint(const Point& point);
 	void removeControlPoint(const int iCtrlPt);
@@ -59,7 +64,14 @@ public:
 
 protected:
 	void init(const float fStartYValue = 0.0f);
+	// the sampled points, for drawing
 	void reevaluate(void) const;
+	// the table of pieces evaluateCurveAt() reads
+	void reevaluateSegments(void) const;
+	// brings the evaluator's pieces up to date with the control points
+	void updatePieces(void) const;
+	// control points iFirst to iLast moved, and nothing else changed
+	void controlPointsMoved(int iFirst, int iLast);
 	// this must be called when a control point is added
 	void sortControlPoints(void) const;
 
@@ -67,8 +79,27 @@ protected:
 
 	mutable std::vector<Point> m_ptvCtrlPts;
 	mutable std::vector<Point> m_ptvEvaluatedCurvePts;
+	// the curve has to be evaluated afresh
 	mutable bool m_bDirty;
 
+	// The evaluator's pieces and the points each is drawn through.
+	// Moving control points only re-evaluates the pieces they shape,
+	// and only those pieces are drawn through new points, which are
+	// spliced in among the others' along with their part of the table.
+	mutable std::vector<CurveSegment> m_pieces;
+	mutable std::vector<std::vector<Point> > m_pieceSamples;
+	mutable std::vector<int> m_pieceStarts;		// of each piece's points
+	mutable float m_fStartY, m_fEndY;
+	mutable int m_iMovedFirst, m_iMovedLast;	// control points moved since, or -1
+	mutable int m_iStaleFirst, m_iStaleLast;	// pieces drawn through old points, or -1
+	mutable int m_iUnjoinedFirst, m_iUnjoinedLast;	// pieces changed since the points were joined
+	mutable int m_iUntabledFirst, m_iUntabledLast;	// and since the table was made, or -1
+	mutable bool m_bPointsDirty;
+
+	mutable CurveSegmentTable m_segments;
+	mutable bool m_bSegmentsDirty;
+	mutable unsigned int m_uSegmentsRevision;
+
 	float m_fMaxX;
 	bool m_bWrap;
 	bool m_bAdaptive;
@@ -0,0 +1,161 @@
+#include "curveBank.h"
+#include "frameTimings.h"
+
+CurveBank::CurveBank() :
+	m_fTime(0.0f),
+	m_bEvaluated(false)
+{
+	m_firsts.push_back(0);
+}
+
+void CurveBank::clear()
+{
+	m_curves.clear();
+	m_revisions.clear();
+	m_firsts.assign(1, 0);
+	m_starts.clear();
+	m_ends.clear();
+	m_startValues.clear();
+	m_endValues.clear();
+	m_cursors.clear();
+	m_values.clear();
+	m_pieceEnds.clear();
+	m_pieces.clear();
+	m_bEvaluated = false;
+}
+
+void CurveBank::add(const Curve* pcrv)
+{
+	m_curves.push_back(pcrv);
+	// copied in on the next update(), whatever the revision
+	m_revisions.push_back(pcrv->segmentsRevision() + 1);
+	m_firsts.push_back(m_firsts.back());
+	m_starts.push_back(0.0f);
+	m_ends.push_back(0.0f);
+	m_startValues.push_back(0.0f);
+	m_endValues.push_back(0.0f);
+	m_cursors.push_back(0);
+	m_values.push_back(0.0f);
+	m_bEvaluated = false;
+}
+
+bool CurveBank::update()
+{
+	// A changed channel with as many pieces as before is copied over
+	// its old ones.  One whose number of pieces changed moves all
+	// those after it, so then every channel is packed again.
+	bool bChanged = false;
+	for (int i = 0; i < (int)m_curves.size(); ++i)
+	{
+		if (m_curves[i]->segmentsRevision() == m_revisions[i])
+			continue;
+		bChanged = true;
+		if (m_curves[i]->segments().size() != m_firsts[i + 1] - m_firsts[i])
+		{
+			repack();
+			return true;
+		}
+		copyChannel(i);
+	}
+	return bChanged;
+}
+
+void CurveBank::repack()
+{
+	int iPieces = 0;
+	for (int i = 0; i < (int)m_curves.size(); ++i)
+	{
+		m_firsts[i] = iPieces;
+		iPieces += m_curves[i]->segments().size();
+	}
+	m_firsts.back() = iPieces;
+	m_pieces.resize(iPieces);
+	m_pieceEnds.resize(iPieces);
+
+	for (int i = 0; i < (int)m_curves.size(); ++i)
+		copyChannel(i);
+}
+
+void CurveBank::copyChannel(int iChannel)
+{
+	const CurveSegmentTable& segments = m_curves[iChannel]->segments();
+	const int iFirst = m_firsts[iChannel];
+	m_revisions[iChannel] = m_curves[iChannel]->segmentsRevision();
+	m_cursors[iChannel] = iFirst;
+
+	for (int j = 0; j < segments.size(); ++j)
+	{
+		m_pieces[iFirst + j] = segments.segment(j);
+		m_pieceEnds[iFirst + j] = segments.segment(j).x1;
+	}
+
+	if (segments.empty())
+		return;
+	const CurveSegment& first = segments.segment(0);
+	const CurveSegment& last = segments.segment(segments.size() - 1);
+	m_starts[iChannel] = first.x0;
+	m_ends[iChannel] = last.x1;
+	m_startValues[iChannel] = (float)first.valueAt(first.x0);
+	m_endValues[iChannel] = (float)last.valueAt(last.x1);
+}
+
+float CurveBank::evaluateChannel(int iChannel, float t)
+{
+	const int iFirst = m_firsts[iChannel];
+	const int iLast = m_firsts[iChannel + 1] - 1;
+	if (iFirst > iLast)
+		return 0.0f;
+	if (t <= m_starts[iChannel])
+		return m_startValues[iChannel];
+	if (t >= m_ends[iChannel])
+		return m_endValues[iChannel];
+
+	// the first piece whose range ends at or past t: playback usually
+	// finds it where the last lookup did or in the piece after
+	int i = m_cursors[iChannel];
+	if (m_pieceEnds[i] < t || (i > iFirst && m_pieceEnds[i - 1] >= t))
+	{
+		++i;
+		if (i > iLast || m_pieceEnds[i] < t || m_pieceEnds[i - 1] >= t)
+		{
+			int lo = iFirst, hi = iLast;
+			while (lo < hi)
+			{
+				int mid = (lo + hi) / 2;
+				if (m_pieceEnds[mid] < t)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			i = lo;
+		}
+	}
+	m_cursors[iChannel] = i;
+
+	return (float)m_pieces[i].valueAt(t);
+}
+
+void CurveBank::evaluate(float t)
+{
+	ScopedTiming timing(TIMING_CURVES);
+
+	update();
+	for (int i = 0; i < (int)m_curves.size(); ++i)
+		m_values[i] = evaluateChannel(i, t);
+
+	m_fTime = t;
+	m_bEvaluated = true;
+}
+
+float CurveBank::value(int iChannel, float t)
+{
+	if (iChannel < 0 || iChannel >= (int)m_curves.size())
+		return 0.0f;
+
+	if (!m_bEvaluated || t != m_fTime ||
+		m_curves[iChannel]->segmentsRevision() != m_revisions[iChannel])
+	{
+		evaluate(t);
+	}
+	return m_values[iChannel];
+}
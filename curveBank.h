@@ -0,0 +1,67 @@
+#ifndef CURVE_BANK_H
+#define CURVE_BANK_H
+
+#include <vector>
+
+#include "curve.h"
+
+// Every control's value at one time, read off the curves all at once.
+//
+// The bank copies the pieces of all its curves end to end into one
+// array, with the ends of their ranges (all the lookups search) in
+// an array of their own, and keeps each channel's place in them,
+// its held end values and the piece its last lookup found in
+// parallel per-channel arrays.  evaluate() walks the channels in one
+// pass and leaves their values in a flat array, so a frame reading
+// the same control over and over reads it out of that array.
+//
+// The curves stay the graphs'; the bank notices when one changes by
+// its segmentsRevision() and copies its pieces again, over the old
+// ones if there are as many, otherwise packing every channel anew.
+class CurveBank {
+public:
+	CurveBank();
+
+	void clear();
+	// channel size() - 1 from now on; the curve must outlive the bank
+	void add(const Curve* pcrv);
+	int size() const { return (int)m_curves.size(); }
+
+	// every channel's value at time t
+	void evaluate(float t);
+	const float* values() const { return m_values.empty() ? NULL : &m_values[0]; }
+
+	// Channel iChannel at time t.  Re-evaluates the bank if t isn't
+	// the time it was last evaluated at or the channel's curve has
+	// changed since; otherwise it's the value already in values().
+	float value(int iChannel, float t);
+
+private:
+	// copies the pieces of the curves that have changed; returns
+	// whether any had
+	bool update();
+	// lays every channel's pieces end to end again and copies them
+	void repack();
+	// copies a channel's pieces into the places it has
+	void copyChannel(int iChannel);
+	float evaluateChannel(int iChannel, float t);
+
+	std::vector<const Curve*> m_curves;
+
+	// per channel
+	std::vector<unsigned int> m_revisions;	// of the curve's pieces when copied
+	std::vector<int> m_firsts;				// first piece; the next channel's ends it
+	std::vector<float> m_starts, m_ends;	// x range the pieces cover
+	std::vector<float> m_startValues, m_endValues;	// held past either end
+	std::vector<int> m_cursors;				// piece of the last lookup
+	std::vector<float> m_values;
+
+	// per piece, all channels end to end
+	std::vector<float> m_pieceEnds;
+	std::vector<CurveSegment> m_pieces;
+
+	float m_fTime;
+	bool m_bEvaluated;
+};
+
+#endif // CURVE_BANK_H
@@ -0,0 +1,257 @@
+#include "curveSegments.h"
+
+#include <algorithm>
+#include <math.h>
+
+static inline double slope(const double c[4], double u)
+{
+	return (3 * c[0] * u + 2 * c[1]) * u + c[2];
+}
+
+static bool startsBefore(const CurveSegment& a, const CurveSegment& b)
+{
+	return a.x0 < b.x0;
+}
+
+void CurveSegment::setCubic(const Vec4d& px, const Vec4d& py)
+{
+	for (int i = 0; i < 4; ++i) {
+		x[i] = px[i];
+		y[i] = py[i];
+	}
+	double xa = x[3], xb = xAt(1);
+	x0 = (float)std::min(xa, xb);
+	x1 = (float)std::max(xa, xb);
+}
+
+void CurveSegment::setLine(const Point& a, const Point& b)
+{
+	setCubic(Vec4d(0, 0, b.x - a.x, a.x), Vec4d(0, 0, b.y - a.y, a.y));
+}
+
+// Newton's method, falling back on bisection whenever a step would
+// leave the bracket around the root
+double CurveSegment::parameterAt(double xTarget) const
+{
+	double xa = x[3];
+	double xb = xAt(1);
+	if (xb == xa)
+		return 0;
+
+	double u = (xTarget - xa) / (xb - xa);
+	if (x[0] == 0 && x[1] == 0)
+		return std::min(std::max(u, 0.0), 1.0);
+
+	bool bIncreasing = (xb > xa);
+	double lo = 0, hi = 1;
+	u = std::min(std::max(u, 0.0), 1.0);
+	for (int i = 0; i < 40 && hi - lo > 1e-12; ++i) {
+		double f = xAt(u) - xTarget;
+		if (fabs(f) < 1e-9)
+			break;
+		if ((f < 0) == bIncreasing)
+			lo = u;
+		else
+			hi = u;
+
+		double d = slope(x, u);
+		double next = (d != 0) ? u - f / d : lo;
+		u = (next > lo && next < hi) ? next : 0.5 * (lo + hi);
+	}
+	return u;
+}
+
+static void addLine(std::vector<CurveSegment>& segments, const Point& a, const Point& b)
+{
+	CurveSegment s;
+	s.setLine(a, b);
+	segments.push_back(s);
+}
+
+// The piece moved along x by shift and cut to the animation; false
+// if none of it is left
+static bool cut(const CurveSegment& piece, double shift, float fAniLength, CurveSegment& s)
+{
+	s = piece;
+	s.x[3] += shift;
+	s.x0 = (float)std::max(piece.x0 + shift, 0.0);
+	s.x1 = (float)std::min(piece.x1 + shift, (double)fAniLength);
+	return s.x0 < s.x1;
+}
+
+// Appends what's left of s past x, joined to x by a line if it starts
+// after it, and moves x (and the value y there) to its end.  Where
+// pieces overlap (a wrapped curve covering the same stretch from both
+// ends, or a curve doubling back) the earlier one wins.
+static void append(std::vector<CurveSegment>& segments, CurveSegment s, float& x, double& y)
+{
+	if (s.x1 <= x)
+		return;
+	if (s.x0 > x)
+		addLine(segments, Point(x, (float)y), Point(s.x0, (float)s.valueAt(s.x0)));
+	else
+		s.x0 = x;
+
+	segments.push_back(s);
+	x = s.x1;
+	y = s.valueAt(s.x1);
+}
+
+// whether pieces first to last start in order of x
+static bool inOrder(const std::vector<CurveSegment>& pieces, int first, int last)
+{
+	for (int i = first; i < last; ++i) {
+		if (!(pieces[i].x0 <= pieces[i + 1].x0))
+			return false;
+	}
+	return true;
+}
+
+void CurveSegmentTable::finish(float fAniLength, bool bWrap, float yStart, float yEnd)
+{
+	std::vector<CurveSegment> pieces;
+	pieces.swap(m_segments);
+	m_iCursor = 0;
+	m_starts.clear();
+	m_fAniLength = fAniLength;
+	m_yStart = yStart;
+	m_yEnd = yEnd;
+
+	float x = 0;
+	double y = yStart;
+	CurveSegment s;
+
+	// Pieces already in order need no sorting, and without wrapping
+	// each is cut to at most one entry, so where every piece's
+	// entries begin is noted for replace()
+	if (!bWrap && inOrder(pieces, 0, (int)pieces.size() - 1)) {
+		m_starts.reserve(pieces.size() + 1);
+		for (int i = 0; i < (int)pieces.size(); ++i) {
+			m_starts.push_back((int)m_segments.size());
+			if (cut(pieces[i], 0.0, fAniLength, s))
+				append(m_segments, s, x, y);
+		}
+		m_starts.push_back((int)m_segments.size());
+	}
+	else {
+		// cut every piece to the animation; with wrapping on, what
+		// reaches past one end comes back in at the other
+		std::vector<CurveSegment> cuts;
+		for (int i = 0; i < (int)pieces.size(); ++i) {
+			for (int k = bWrap ? -1 : 0; k <= (bWrap ? 1 : 0); ++k) {
+				if (cut(pieces[i], k * (double)fAniLength, fAniLength, s))
+					cuts.push_back(s);
+			}
+		}
+		std::stable_sort(cuts.begin(), cuts.end(), startsBefore);
+
+		for (int i = 0; i < (int)cuts.size(); ++i)
+			append(m_segments, cuts[i], x, y);
+	}
+	if (x < fAniLength)
+		addLine(m_segments, Point(x, (float)y), Point(fAniLength, yEnd));
+}
+
+bool CurveSegmentTable::replace(const std::vector<CurveSegment>& pieces, int first, int last,
+	float fAniLength, bool bWrap, float yStart, float yEnd)
+{
+	const int iPieces = (int)pieces.size();
+	if (bWrap || (int)m_starts.size() != iPieces + 1 || first < 0 || first > last || last >= iPieces ||
+		fAniLength != m_fAniLength || yStart != m_yStart || yEnd != m_yEnd)
+		return false;
+
+	// the rest were in order, so only the changed pieces and those
+	// either side of them can be out of it now
+	if (!inOrder(pieces, std::max(first - 1, 0), std::min(last + 1, iPieces - 1)))
+		return false;
+
+	// How much of the piece after is left depends on where the
+	// changed ones end, so it's redone too; the entries after it only
+	// depend on where it ends, which is checked to be the same
+	const int iLast = std::min(last + 1, iPieces - 1);
+	const int iBegin = m_starts[first];
+	int iEnd = m_starts[iLast + 1];
+
+	float x = 0;
+	double y = yStart;
+	if (iBegin > 0) {
+		const CurveSegment& before = m_segments[iBegin - 1];
+		x = before.x1;
+		y = before.valueAt(before.x1);
+	}
+	std::vector<CurveSegment> entries;
+	std::vector<int> starts;
+	CurveSegment s;
+	for (int i = first; i <= iLast; ++i) {
+		starts.push_back((int)entries.size());
+		if (cut(pieces[i], 0.0, fAniLength, s))
+			append(entries, s, x, y);
+	}
+	starts.push_back((int)entries.size());
+
+	if (iLast == iPieces - 1) {
+		if (x < fAniLength)
+			addLine(entries, Point(x, (float)y), Point(fAniLength, yEnd));
+		iEnd = size();
+	}
+	else if (iEnd > 0) {
+		const CurveSegment& end = m_segments[iEnd - 1];
+		if (x != end.x1 || y != end.valueAt(end.x1))
+			return false;
+	}
+	else if (x != 0 || y != yStart) {
+		return false;
+	}
+
+	const int iNew = (int)entries.size();
+	if (iNew > iEnd - iBegin)
+		m_segments.insert(m_segments.begin() + iEnd, iNew - (iEnd - iBegin), CurveSegment());
+	else if (iNew < iEnd - iBegin)
+		m_segments.erase(m_segments.begin() + iBegin + iNew, m_segments.begin() + iEnd);
+	std::copy(entries.begin(), entries.end(), m_segments.begin() + iBegin);
+
+	const int iShift = iBegin + starts.back() - m_starts[iLast + 1];
+	for (int i = first + 1; i <= iLast + 1; ++i)
+		m_starts[i] = iBegin + starts[i - first];
+	for (int i = iLast + 2; i <= iPieces; ++i)
+		m_starts[i] += iShift;
+	m_iCursor = 0;
+	return true;
+}
+
+float CurveSegmentTable::valueAt(float x) const
+{
+	if (m_segments.empty())
+		return 0.0f;
+
+	const CurveSegment& first = m_segments.front();
+	const CurveSegment& last = m_segments.back();
+	if (x <= first.x0)
+		return (float)first.valueAt(first.x0);
+	if (x >= last.x1)
+		return (float)last.valueAt(last.x1);
+
+	return (float)m_segments[segmentAt(x)].valueAt(x);
+}
+
+/** The first piece whose range ends at or past x **/
+int CurveSegmentTable::segmentAt(float x) const
+{
+	int iLast = (int)m_segments.size() - 1;
+
+	// the piece of the last lookup, then the one after it
+	for (int i = m_iCursor; i <= m_iCursor + 1 && i <= iLast; ++i) {
+		if (m_segments[i].x1 >= x && (i == 0 || m_segments[i - 1].x1 < x))
+			return m_iCursor = i;
+	}
+
+	int lo = 0, hi = iLast;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (m_segments[mid].x1 < x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return m_iCursor = lo;
+}
@@ -0,0 +1,86 @@
+#ifndef CURVE_SEGMENTS_H
+#define CURVE_SEGMENTS_H
+
+#pragma warning(disable : 4786)
+
+#include <vector>
+
+#include "point.h"
+#include "vec.h"
+
+// One piece of an evaluated curve: x and y as cubics in a parameter
+// u in [0, 1], highest power first, so
+// x(u) = ((x[0] * u + x[1]) * u + x[2]) * u + x[3].  The piece
+// answers for x in [x0, x1], which is less than it spans when it has
+// been cut at either end of the animation.
+struct CurveSegment {
+	float x0, x1;
+	double x[4];
+	double y[4];
+
+	// coefficients as basis * control values, as the evaluators'
+	// matrices give them
+	void setCubic(const Vec4d& px, const Vec4d& py);
+	void setLine(const Point& a, const Point& b);
+
+	double xAt(double u) const { return ((x[0] * u + x[1]) * u + x[2]) * u + x[3]; }
+	double yAt(double u) const { return ((y[0] * u + y[1]) * u + y[2]) * u + y[3]; }
+	bool isLine() const { return x[0] == 0 && x[1] == 0 && y[0] == 0 && y[1] == 0; }
+
+	// the u where x(u) is x, for x between x(0) and x(1)
+	double parameterAt(double x) const;
+	double valueAt(double x) const { return yAt(parameterAt(x)); }
+};
+
+// An evaluated curve as a table of cubic pieces sorted by x.  The
+// value at any x is a lookup, a root of x(u) and a Horner evaluation
+// of y(u): exact, where the sampled points only approximate it, and
+// a fraction of their size.
+//
+// The pieces are added in any order and then the table is
+// finish()ed, which sorts them, wraps (or clips) whatever reaches
+// past either end of the animation and joins any gaps with straight
+// lines.
+class CurveSegmentTable {
+public:
+	CurveSegmentTable() : m_iCursor(0), m_fAniLength(0.0f), m_yStart(0.0f), m_yEnd(0.0f) {}
+
+	void clear() { m_segments.clear(); m_starts.clear(); m_iCursor = 0; }
+	bool empty() const { return m_segments.empty(); }
+	int size() const { return (int)m_segments.size(); }
+	const CurveSegment& segment(int i) const { return m_segments[i]; }
+
+	void add(const CurveSegment& segment) { m_segments.push_back(segment); }
+
+	// yStart and yEnd are the curve's values at 0 and fAniLength,
+	// where the pieces don't reach that far
+	void finish(float fAniLength, bool bWrap, float yStart, float yEnd);
+
+	// Redoes the entries of pieces first to last, which are all that
+	// changed in pieces since they were add()ed and finish()ed, and
+	// moves the entries after them along.  Only a table of pieces in
+	// order of x that doesn't wrap can be; otherwise, or when the
+	// change reaches the entries of later pieces, it returns false
+	// and leaves the table as it was, to be built again.
+	bool replace(const std::vector<CurveSegment>& pieces, int first, int last,
+		float fAniLength, bool bWrap, float yStart, float yEnd);
+
+	// the value at x, held level past either end
+	float valueAt(float x) const;
+
+private:
+	int segmentAt(float x) const;
+
+	std::vector<CurveSegment> m_segments;
+	// piece the last lookup found; playback usually finds the next
+	// value here or in the piece after
+	mutable int m_iCursor;
+
+	// where each piece's entries begin, then where the last ends, if
+	// replace() can redo them; and what the table was finish()ed with
+	std::vector<int> m_starts;
+	float m_fAniLength;
+	float m_yStart, m_yEnd;
+};
+
+#endif // CURVE_SEGMENTS_H
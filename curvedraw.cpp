@@ -0,0 +1,67 @@
+#include "Curve.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif // WIN32
+#include <GL/gl.h>
+
+// Drawing lives apart from the rest of Curve so the curves can be
+// linked without GL
+
+void Curve::drawCurve() const
+{
+	reevaluate();
+
+	drawEvaluatedCurveSegments();
+}
+
+void Curve::drawEvaluatedCurveSegments() const
+{
+	reevaluate();
+
+	glBegin(GL_LINE_STRIP);
+
+		for (std::vector<Point>::const_iterator it = m_ptvEvaluatedCurvePts.begin(); 
+			it != m_ptvEvaluatedCurvePts.end(); 
+			++it) {
+			glVertex2f(it->x, it->y);
+		}
+
+	glEnd();
+}
+
+void Curve::drawControlPoint(int iCtrlPt) const
+{
+	reevaluate();
+
+	double fPointSize;
+	glGetDoublev(GL_POINT_SIZE, &fPointSize);
+	glPointSize(7.0);
+
+	glColor3d(1,0,0);
+	glBegin(GL_POINTS);
+		glVertex2f(m_ptvCtrlPts[iCtrlPt].x, m_ptvCtrlPts[iCtrlPt].y);
+	glEnd();
+
+	glPointSize(fPointSize);
+}
+
+void Curve::drawControlPoints() const
+{
+	reevaluate();
+
+	double fPointSize;
+	glGetDoublev(GL_POINT_SIZE, &fPointSize);
+	glPointSize(7.0);
+
+	glColor3d(1,1,1);
+	glBegin(GL_POINTS);
+		for (std::vector<Point>::const_iterator kit = m_ptvCtrlPts.begin(); 
+			kit != m_ptvCtrlPts.end(); 
+			++kit) {
+			glVertex2f(kit->x, kit->y);
+		}
+	glEnd();
+
+	glPointSize(fPointSize);
+}
@@ -1,8 +1,258 @@
-#include "CurveEvaluator.h"
+#include "curveevaluator.h"
+
+#include <algorithm>
 
 float CurveEvaluator::s_fFlatnessEpsilon = 0.0001f;
-int CurveEvaluator::s_iSegCount = 16;
+int CurveEvaluator::s_iSegCount = 30;
 
 CurveEvaluator::~CurveEvaluator(void)
 {
 }
+
+void CurveEvaluator::reevaluatePieces(const std::vector<Point>& ptvCtrlPts,
+									  std::vector<CurveSegment>& pieces,
+									  int& iFirst,
+									  int& iLast,
+									  const float& fAniLength,
+									  const bool& bWrap,
+									  const double& dTension) const
+{
+	// a piece depends on the few points around it, all of which
+	// affectedPieces() took in
+	evaluatePieces(ptvCtrlPts, pieces, iFirst, iLast, fAniLength, bWrap, dTension);
+}
+
+static bool flatEnough(const Point V[4])
+{
+	return ((V[0].distance(V[1]) + V[1].distance(V[2]) + V[2].distance(V[3]))/V[0].distance(V[3]) < (1 + CurveEvaluator::s_fFlatnessEpsilon));
+}
+
+// de Casteljau subdivision until each part is flat enough; pushes
+// every part's end, the start being the previous part's
+static void subdivide(std::vector<Point>& samples, const Point V[4], int iDepth)
+{
+	if (iDepth == 0 || flatEnough(V))
+	{
+		samples.push_back(V[3]);
+	}
+	else
+	{
+		Point VV[3];
+		VV[0] = Point((V[0].x + V[1].x)/2, (V[0].y + V[1].y)/2);
+		VV[1] = Point((V[1].x + V[2].x)/2, (V[1].y + V[2].y)/2);
+		VV[2] = Point((V[2].x + V[3].x)/2, (V[2].y + V[3].y)/2);
+		Point VVV[2];
+		VVV[0] = Point((VV[0].x + VV[1].x)/2, (VV[0].y + VV[1].y)/2);
+		VVV[1] = Point((VV[1].x + VV[2].x)/2, (VV[1].y + VV[2].y)/2);
+		Point Q((VVV[0].x + VVV[1].x)/2, (VVV[0].y + VVV[1].y)/2);
+
+		const Point left[4] = { V[0], VV[0], VVV[0], Q };
+		const Point right[4] = { Q, VVV[1], VV[2], V[3] };
+		subdivide(samples, left, iDepth - 1);
+		subdivide(samples, right, iDepth - 1);
+	}
+}
+
+void CurveEvaluator::tessellate(const CurveSegment& piece,
+								std::vector<Point>& samples,
+								const bool& adaptive)
+{
+	samples.clear();
+
+	if (piece.isLine())
+	{
+		samples.push_back(Point(piece.xAt(0), piece.yAt(0)));
+		samples.push_back(Point(piece.xAt(1), piece.yAt(1)));
+	}
+	else if (adaptive)
+	{
+		// the piece's Bezier control points, from its powers of u
+		Point V[4];
+		V[0] = Point(piece.x[3], piece.y[3]);
+		V[1] = Point(piece.x[3] + piece.x[2] / 3, piece.y[3] + piece.y[2] / 3);
+		V[2] = Point(piece.x[3] + (2 * piece.x[2] + piece.x[1]) / 3,
+			piece.y[3] + (2 * piece.y[2] + piece.y[1]) / 3);
+		V[3] = Point(piece.xAt(1), piece.yAt(1));
+
+		samples.push_back(V[0]);
+		subdivide(samples, V, 10);
+	}
+	else
+	{
+		for (int i = 0; i <= s_iSegCount; ++i)
+		{
+			const double u = i / (double)s_iSegCount;
+			samples.push_back(Point(piece.xAt(u), piece.yAt(u)));
+		}
+	}
+}
+
+// Appends p if it is past the last point, so points stays sorted; a
+// curve doubling back keeps the stretch it reached first.  The first
+// point in is held level from 0.
+static inline void appendInOrder(std::vector<Point>& points, const Point& p, float start_value)
+{
+	if (points.empty())
+	{
+		if (p.x > 0)
+			points.push_back(Point(0.0f, start_value));
+	}
+	else if (p.x <= points.back().x)
+	{
+		return;
+	}
+	points.push_back(p);
+}
+
+// Appends the part of the line from a to b with x in [lo, hi],
+// moved left by lo
+static void appendClipped(std::vector<Point>& points, const Point& a, const Point& b,
+						  float lo, float hi, float start_value)
+{
+	if (b.x <= a.x)
+	{
+		if (b.x >= lo && b.x <= hi)
+			appendInOrder(points, Point(b.x - lo, b.y), start_value);
+		return;
+	}
+
+	const float t0 = std::max((lo - a.x) / (b.x - a.x), 0.0f);
+	const float t1 = std::min((hi - a.x) / (b.x - a.x), 1.0f);
+	if (t0 > t1)
+		return;
+	appendInOrder(points, Point(a.x + t0 * (b.x - a.x) - lo, a.y + t0 * (b.y - a.y)), start_value);
+	appendInOrder(points, Point(a.x + t1 * (b.x - a.x) - lo, a.y + t1 * (b.y - a.y)), start_value);
+}
+
+// Appends the part of a piece's samples with x in [lo, hi]
+static void appendPiece(std::vector<Point>& points, const std::vector<Point>& run,
+						float lo, float hi, float start_value)
+{
+	if (run.size() == 1 && run[0].x >= lo && run[0].x <= hi)
+		appendInOrder(points, Point(run[0].x - lo, run[0].y), start_value);
+	for (int j = 1; j < (int)run.size(); ++j)
+		appendClipped(points, run[j - 1], run[j], lo, hi, start_value);
+}
+
+// A wrapped curve is read through three windows in turn: what
+// reaches past the end comes in first at 0, what falls before 0
+// comes in last, up to the end
+static inline int windowCount(bool wrap_control_points)
+{
+	return wrap_control_points ? 3 : 1;
+}
+
+static inline float windowStart(int iWindow, bool wrap_control_points, float animation_length)
+{
+	return ((wrap_control_points ? 1 : 0) - iWindow) * animation_length;
+}
+
+void CurveEvaluator::joinPieces(const std::vector<std::vector<Point> >& samples,
+								std::vector<Point>& points,
+								std::vector<int>& starts,
+								const float& animation_length,
+								const bool& wrap_control_points,
+								const float& start_value,
+								const float& end_value)
+{
+	int iCount = 2;
+	for (int i = 0; i < (int)samples.size(); ++i)
+		iCount += samples[i].size() + 4;
+	points.clear();
+	points.reserve(iCount);
+	starts.clear();
+
+	for (int k = 0; k < windowCount(wrap_control_points); ++k)
+	{
+		const float lo = windowStart(k, wrap_control_points, animation_length);
+		const float hi = lo + animation_length;
+		for (int i = 0; i < (int)samples.size(); ++i)
+		{
+			starts.push_back((int)points.size());
+			appendPiece(points, samples[i], lo, hi, start_value);
+		}
+		starts.push_back((int)points.size());
+	}
+
+	if (points.empty())
+		points.push_back(Point(0.0f, start_value));
+	if (points.back().x < animation_length)
+		points.push_back(Point(animation_length, end_value));
+}
+
+bool CurveEvaluator::rejoinPieces(const std::vector<std::vector<Point> >& samples,
+								  std::vector<Point>& points,
+								  std::vector<int>& starts,
+								  const int first,
+								  const int last,
+								  const float& animation_length,
+								  const bool& wrap_control_points,
+								  const float& start_value)
+{
+	const int iPieces = (int)samples.size();
+	const int iWindows = windowCount(wrap_control_points);
+	if ((int)starts.size() != iWindows * (iPieces + 1) || first < 0 || first > last || last >= iPieces)
+		return false;
+
+	// Which of its points the piece after keeps depends on where the
+	// changed ones end, so it's joined again too; the points after it
+	// only depend on its last one, which is checked to be the same
+	const int iLast = std::min(last + 1, iPieces - 1);
+
+	std::vector<std::vector<Point> > runs(iWindows);
+	std::vector<int> runStarts;
+	for (int k = 0; k < iWindows; ++k)
+	{
+		const float lo = windowStart(k, wrap_control_points, animation_length);
+		const int* pStarts = &starts[k * (iPieces + 1)];
+		const int iBegin = pStarts[first], iEnd = pStarts[iLast + 1];
+
+		// carry on from the point before, which is dropped again after
+		std::vector<Point>& run = runs[k];
+		if (iBegin > 0)
+			run.push_back(points[iBegin - 1]);
+		for (int i = first; i <= iLast; ++i)
+		{
+			runStarts.push_back((int)run.size() - (iBegin > 0 ? 1 : 0));
+			appendPiece(run, samples[i], lo, lo + animation_length, start_value);
+		}
+
+		if (run.empty() != (iEnd == 0))
+			return false;
+		if (!run.empty() && (run.back().x != points[iEnd - 1].x || run.back().y != points[iEnd - 1].y))
+			return false;
+		if (iBegin > 0)
+			run.erase(run.begin());
+	}
+
+	// The last window goes in first, so the others' points stay put
+	// until their turn; usually as many points come out as went in
+	// and they are just overwritten
+	for (int k = iWindows - 1; k >= 0; --k)
+	{
+		const int* pStarts = &starts[k * (iPieces + 1)];
+		const int iBegin = pStarts[first], iEnd = pStarts[iLast + 1];
+		const int iNew = (int)runs[k].size();
+		if (iNew > iEnd - iBegin)
+			points.insert(points.begin() + iEnd, iNew - (iEnd - iBegin), Point());
+		else if (iNew < iEnd - iBegin)
+			points.erase(points.begin() + iBegin + iNew, points.begin() + iEnd);
+		std::copy(runs[k].begin(), runs[k].end(), points.begin() + iBegin);
+	}
+
+	// the points of the pieces after the changed ones moved along
+	int iShift = 0;
+	for (int k = 0; k < iWindows; ++k)
+	{
+		int* pStarts = &starts[k * (iPieces + 1)];
+		const int iOld = pStarts[iLast + 1] - pStarts[first];
+		for (int i = 0; i <= first; ++i)
+			pStarts[i] += iShift;
+		for (int i = first + 1; i <= iLast; ++i)
+			pStarts[i] = pStarts[first] + runStarts[k * (iLast - first + 1) + i - first];
+		iShift += (int)runs[k].size() - iOld;
+		for (int i = iLast + 1; i <= iPieces; ++i)
+			pStarts[i] += iShift;
+	}
+	return true;
+}
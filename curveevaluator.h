@@ -3,20 +3,104 @@
 
 #pragma warning(disable : 4786)
 
-#include "Curve.h"
+#include "curve.h"
+#include "curveSegments.h"
+
+// the number a curve's type is saved as in a .ani script
+#define CURVE_TYPE_LINEAR 0
+#define CURVE_TYPE_BSPLINE 1
+#define CURVE_TYPE_BEZIER 2
+#define CURVE_TYPE_CATMULLROM 3
+#define CURVE_TYPE_C2INTERPOLATING 4
+#define CURVE_TYPE_COUNT 5
 
 //using namespace std;
 
+// An evaluator makes a curve out of cubic pieces (CurveSegments),
+// each shaped by a few neighbouring control points.  The curve draws
+// the pieces' samples and reads its values off the pieces directly;
+// when control points move it asks which pieces they have a part in
+// and re-evaluates only those.
 class CurveEvaluator
 {
 public:
 	virtual ~CurveEvaluator(void);
-	virtual void evaluateCurve(const std::vector<Point>& control_points, 
-							   std::vector<Point>& evaluated_curve_points, 
-							   const float& animation_length, 
-							   const bool& wrap_control_points,
-							   const bool& adaptive,
-							   const double& tension) const = 0;
+
+	virtual int pieceCount(const std::vector<Point>& control_points,
+						   const bool& wrap_control_points) const = 0;
+	// Recomputes pieces first to last, of a vector already
+	// pieceCount() long
+	virtual void evaluatePieces(const std::vector<Point>& control_points,
+								std::vector<CurveSegment>& pieces,
+								const int first,
+								const int last,
+								const float& animation_length,
+								const bool& wrap_control_points,
+								const double& tension) const = 0;
+	// Recomputes the pieces after control points moved: first to
+	// last, from affectedPieces(), and any others the move changed,
+	// widening first and last to take them in.  The pieces come out
+	// as evaluatePieces() over the whole curve would give them.
+	virtual void reevaluatePieces(const std::vector<Point>& control_points,
+								  std::vector<CurveSegment>& pieces,
+								  int& first,
+								  int& last,
+								  const float& animation_length,
+								  const bool& wrap_control_points,
+								  const double& tension) const;
+	// The range of pieces that control points first_point to
+	// last_point shape, clipped to the curve's pieces
+	virtual void affectedPieces(const std::vector<Point>& control_points,
+								const int first_point,
+								const int last_point,
+								const bool& wrap_control_points,
+								int& first,
+								int& last) const = 0;
+	// The values held from 0 to the first piece and from the last
+	// piece to the end of the animation
+	virtual void endValues(const std::vector<Point>& control_points,
+						   const float& animation_length,
+						   const bool& wrap_control_points,
+						   float& start_value,
+						   float& end_value) const = 0;
+
+	// The points a piece is drawn through: s_iSegCount evenly spaced
+	// in its parameter, or as few as keep it within
+	// s_fFlatnessEpsilon of straight when adaptive.  They are where
+	// the piece puts them, which may be past either end of the
+	// animation.
+	static void tessellate(const CurveSegment& piece,
+						   std::vector<Point>& samples,
+						   const bool& adaptive);
+	// The whole curve through the pieces' samples, in order of x from
+	// 0 to animation_length, so it needs no sorting.  With wrapping on
+	// the pieces are cut where they cross either end and the part
+	// outside comes back in at the other; with it off they are cut to
+	// the animation.  Where the pieces don't reach an end the curve is
+	// held at start_value or end_value.  points is cleared and keeps
+	// its capacity.  starts is where each piece's points begin in
+	// each window (then where the window ends), for rejoinPieces().
+	static void joinPieces(const std::vector<std::vector<Point> >& samples,
+						   std::vector<Point>& points,
+						   std::vector<int>& starts,
+						   const float& animation_length,
+						   const bool& wrap_control_points,
+						   const float& start_value,
+						   const float& end_value);
+	// Joins the samples of pieces first to last into points again,
+	// after they and nothing else changed since joinPieces(), and
+	// moves the points after them along.  Returns false, leaving
+	// points as they were, when that would change which points of
+	// the later pieces are kept; the curve must be joined whole then.
+	static bool rejoinPieces(const std::vector<std::vector<Point> >& samples,
+							 std::vector<Point>& points,
+							 std::vector<int>& starts,
+							 const int first,
+							 const int last,
+							 const float& animation_length,
+							 const bool& wrap_control_points,
+							 const float& start_value);
+
 	static float s_fFlatnessEpsilon;
 	static int s_iSegCount;
 };
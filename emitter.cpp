@@ -0,0 +1,93 @@
+#include "emitter.h"
+#include "particle.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.141592653589793238462643383279502
+#endif
+
+static inline Vec3d transformPoint(const Mat4d& m, const Vec3d& p)
+{
+	return Vec3d(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+				 m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+				 m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]);
+}
+
+static inline Vec3d transformVector(const Mat4d& m, const Vec3d& v)
+{
+	return Vec3d(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+				 m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+				 m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+}
+
+Emitter::Emitter() :
+	m_fRate(0),
+	m_shape(EMITTER_POINT),
+	m_fRadius(0),
+	m_velocity(0, 0, 0),
+	m_spread(0, 0, 0),
+	m_fMassLo(1),
+	m_fMassHi(1),
+	m_fLifetime(ParticleStore::kImmortal),
+	m_bPlaced(false),
+	m_fOwed(0)
+{
+}
+
+void Emitter::setTransform(const Mat4d& toWorld)
+{
+	m_prev = m_bPlaced ? m_cur : toWorld;
+	m_cur = toWorld;
+	m_bPlaced = true;
+}
+
+void Emitter::reset()
+{
+	m_bPlaced = false;
+	m_fOwed = 0;
+}
+
+int Emitter::emit(ParticleStore& particles, double h, double from, double to, RandomStream& random)
+{
+	m_fOwed += m_fRate * h;
+	int n = (int)floor(m_fOwed);
+	m_fOwed -= n;
+
+	for (int i = 0; i < n; ++i)
+	{
+		Vec3d local(0, 0, 0);
+		switch (m_shape)
+		{
+		case EMITTER_POINT:
+			break;
+		case EMITTER_SPHERE:
+		{
+			// rejection sampling the cube keeps this uniform in volume
+			do {
+				local = Vec3d(random.uniform(-1, 1), random.uniform(-1, 1), random.uniform(-1, 1));
+			} while (local * local > 1);
+			local *= m_fRadius;
+			break;
+		}
+		case EMITTER_DISC:
+		{
+			double r = m_fRadius * sqrt(random.uniform());
+			double phi = 2 * M_PI * random.uniform();
+			local = Vec3d(r * cos(phi), r * sin(phi), 0);
+			break;
+		}
+		}
+
+		// spread the births evenly over the step's share of the motion
+		double f = from + (to - from) * (i + random.uniform()) / n;
+		Vec3d p = transformPoint(m_prev, local) * (1 - f) + transformPoint(m_cur, local) * f;
+
+		Vec3d v(m_velocity[0] + random.uniform(-1, 1) * m_spread[0],
+				m_velocity[1] + random.uniform(-1, 1) * m_spread[1],
+				m_velocity[2] + random.uniform(-1, 1) * m_spread[2]);
+		double mass = random.uniform(m_fMassLo, m_fMassHi);
+		particles.add(p, transformVector(m_cur, v), mass, m_fLifetime);
+	}
+	return n;
+}
@@ -0,0 +1,76 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include "vec.h"
+#include "mat.h"
+#include "randomStream.h"
+#include <functional>
+
+class ParticleStore;
+
+enum EmitterShape {
+	EMITTER_POINT,		// every particle from the origin
+	EMITTER_SPHERE,		// anywhere inside a ball of the given radius
+	EMITTER_DISC,		// anywhere on a disc in the local xy plane
+};
+
+// Adds particles at a steady rate while the simulation runs, however
+// often the scene is redrawn.  Particles come from a shape placed by
+// the emitter's transform and leave it with a random speed around a
+// mean; both are in the emitter's frame, so the spray turns with
+// whatever the emitter is attached to.
+//
+// The transform (and anything else that is animated) is fed in by a
+// driver, called with the current time once a frame before the
+// frame's steps.  Particles born during those steps come from
+// between the previous placement and the new one, so a moving
+// emitter draws a continuous trail rather than a clump per frame.
+class Emitter {
+public:
+	typedef std::function<void(Emitter&, float)> Driver;
+
+	Emitter();
+
+	// particles per second
+	void setRate(double r) { if (r >= 0) m_fRate = r; }
+	double getRate() const { return m_fRate; }
+	void setShape(EmitterShape shape, double radius = 0) { m_shape = shape; m_fRadius = radius; }
+	// each component of the starting speed is uniform in
+	// mean +- spread, in the emitter's frame
+	void setVelocity(const Vec3d& mean, const Vec3d& spread) { m_velocity = mean; m_spread = spread; }
+	void setMass(double lo, double hi) { m_fMassLo = lo; m_fMassHi = hi; }
+	// Seconds each particle lives.  Dead particles' slots are reused,
+	// so the particle count levels off at about rate * lifetime.
+	void setLifetime(float t) { if (t > 0) m_fLifetime = t; }
+	float getLifetime() const { return m_fLifetime; }
+
+	// where the emitter is now; the first placement after reset() is
+	// also taken as where it was
+	void setTransform(const Mat4d& toWorld);
+	void setDriver(const Driver& driver) { m_driver = driver; }
+	void drive(float t) { if (m_driver) m_driver(*this, t); }
+
+	// Forgets the placement and the fraction of a particle owed, for
+	// a simulation started afresh
+	void reset();
+
+	// Adds the particles due over a step of length h, which covers
+	// the fraction [from, to] of the way from the previous placement
+	// to the current one.  random should be seeded for this step.
+	int emit(ParticleStore& particles, double h, double from, double to, RandomStream& random);
+
+private:
+	double m_fRate;
+	EmitterShape m_shape;
+	double m_fRadius;
+	Vec3d m_velocity, m_spread;
+	double m_fMassLo, m_fMassHi;
+	float m_fLifetime;
+
+	Driver m_driver;
+	Mat4d m_prev, m_cur;
+	bool m_bPlaced;
+	double m_fOwed;			// particles due but not yet emitted, less than one
+};
+
+#endif // EMITTER_H
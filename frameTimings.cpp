@@ -0,0 +1,142 @@
+#include "frameTimings.h"
+
+thread_local StageTimer* StageTimer::s_pCurrent = NULL;
+
+void StageTimer::start()
+{
+	if (m_bRunning)
+		return;
+	m_bRunning = true;
+	m_nInner = 0;
+	m_pOuter = s_pCurrent;
+	s_pCurrent = this;
+	m_start = std::chrono::steady_clock::now();
+}
+
+void StageTimer::stop()
+{
+	if (!m_bRunning)
+		return;
+	long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - m_start).count();
+
+	FrameTimings::instance().add(m_stage, ns - m_nInner);
+	if (m_pOuter)
+		m_pOuter->m_nInner += ns;
+	s_pCurrent = m_pOuter;
+	m_bRunning = false;
+}
+
+FrameTimings& FrameTimings::instance()
+{
+	static FrameTimings timings;
+	return timings;
+}
+
+const char* FrameTimings::stageName(TimingStage stage)
+{
+	switch (stage)
+	{
+	case TIMING_DRAW: return "draw";
+	case TIMING_SIMULATE: return "simulate";
+	case TIMING_CURVES: return "curves";
+	case TIMING_SAVE_BMP: return "save_bmp";
+	default: return "";
+	}
+}
+
+FrameTimings::FrameTimings() :
+	m_iNext(0),
+	m_iCount(0),
+	m_bEnded(false),
+	m_pCsv(NULL),
+	m_iCsvFrame(0)
+{
+	for (int i = 0; i < TIMING_STAGE_COUNT; ++i)
+		m_pending[i] = 0;
+}
+
+FrameTimings::~FrameTimings()
+{
+	stopCsv();
+}
+
+void FrameTimings::endFrame()
+{
+	Clock::time_point now = Clock::now();
+
+	Frame& frame = m_frames[m_iNext];
+	for (int i = 0; i < TIMING_STAGE_COUNT; ++i)
+		frame.ms[i] = m_pending[i].exchange(0) * 1e-6;
+	// the first frame has nothing to measure from
+	frame.frameMs = m_bEnded ? std::chrono::duration<double, std::milli>(now - m_lastEnd).count() : 0;
+	m_lastEnd = now;
+	m_bEnded = true;
+
+	m_iNext = (m_iNext + 1) % kWindow;
+	if (m_iCount < kWindow)
+		++m_iCount;
+
+	if (m_pCsv)
+	{
+		fprintf(m_pCsv, "%d,%.4f", m_iCsvFrame++, frame.frameMs);
+		for (int i = 0; i < TIMING_STAGE_COUNT; ++i)
+			fprintf(m_pCsv, ",%.4f", frame.ms[i]);
+		fprintf(m_pCsv, "\n");
+	}
+}
+
+double FrameTimings::averageMs(TimingStage stage) const
+{
+	if (m_iCount == 0)
+		return 0;
+	double sum = 0;
+	for (int i = 0; i < m_iCount; ++i)
+		sum += m_frames[i].ms[stage];
+	return sum / m_iCount;
+}
+
+double FrameTimings::lastMs(TimingStage stage) const
+{
+	return m_iCount ? last().ms[stage] : 0;
+}
+
+double FrameTimings::averageFrameMs() const
+{
+	// the very first frame has no interval
+	int n = 0;
+	double sum = 0;
+	for (int i = 0; i < m_iCount; ++i)
+	{
+		if (m_frames[i].frameMs > 0)
+		{
+			sum += m_frames[i].frameMs;
+			++n;
+		}
+	}
+	return n ? sum / n : 0;
+}
+
+bool FrameTimings::startCsv(const char* szFileName)
+{
+	stopCsv();
+	m_pCsv = fopen(szFileName, "w");
+	if (!m_pCsv)
+		return false;
+
+	m_iCsvFrame = 0;
+	fprintf(m_pCsv, "frame,frame_ms");
+	for (int i = 0; i < TIMING_STAGE_COUNT; ++i)
+		fprintf(m_pCsv, ",%s_ms", stageName((TimingStage)i));
+	fprintf(m_pCsv, "\n");
+	return true;
+}
+
+void FrameTimings::stopCsv()
+{
+	if (m_pCsv)
+	{
+		fclose(m_pCsv);
+		m_pCsv = NULL;
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef FRAME_TIMINGS_H
+#define FRAME_TIMINGS_H
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+// The stages of a frame that are timed
+enum TimingStage {
+	TIMING_DRAW,		// ModelerView::draw() to endDraw(), less what's below
+	TIMING_SIMULATE,	// particle steps, on whichever thread runs them
+	TIMING_CURVES,		// re-evaluating dirty animation curves, reading the controls off them
+	TIMING_SAVE_BMP,	// reading back and writing a frame's bitmap
+	TIMING_STAGE_COUNT
+};
+
+// Where the time of each frame goes.  Timers add to the frame in
+// progress from any thread; endFrame(), called once a frame by the
+// view, closes it into a ring of the last kWindow frames and, while
+// recording, appends it as a row of a CSV file.
+//
+// Times are exclusive: a timer started inside another (the particle
+// steps run inside the draw) is taken off the outer one, so the
+// stages of a frame add up to no more than the frame.
+class FrameTimings {
+public:
+	static const int kWindow = 120;
+
+	static FrameTimings& instance();
+	static const char* stageName(TimingStage stage);
+
+	// nanoseconds spent in a stage; safe from any thread
+	void add(TimingStage stage, long long ns) { m_pending[stage] += ns; }
+	void endFrame();
+
+	// over the frames in the window, 0 before the first frame
+	int frameCount() const { return m_iCount; }
+	double averageMs(TimingStage stage) const;
+	double lastMs(TimingStage stage) const;
+	// time from one endFrame() to the next
+	double averageFrameMs() const;
+
+	// Appends every frame from now on to a CSV file, replacing it.
+	// Returns false if the file can't be written.
+	bool startCsv(const char* szFileName);
+	void stopCsv();
+	bool csvOpen() const { return m_pCsv != NULL; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Frame {
+		double ms[TIMING_STAGE_COUNT];
+		double frameMs;
+	};
+
+	FrameTimings();
+	~FrameTimings();
+	FrameTimings(const FrameTimings&);
+	FrameTimings& operator=(const FrameTimings&);
+
+	const Frame& last() const { return m_frames[(m_iNext + kWindow - 1) % kWindow]; }
+
+	std::atomic<long long> m_pending[TIMING_STAGE_COUNT];
+
+	Frame m_frames[kWindow];
+	int m_iNext;
+	int m_iCount;
+	bool m_bEnded;
+	Clock::time_point m_lastEnd;
+
+	FILE* m_pCsv;
+	int m_iCsvFrame;
+};
+
+// Times one stage, from start() to stop(), on one thread.  Timers
+// on the same thread must nest.
+class StageTimer {
+public:
+	StageTimer(TimingStage stage) : m_stage(stage), m_bRunning(false) {}
+
+	void start();
+	void stop();
+	bool running() const { return m_bRunning; }
+
+private:
+	TimingStage m_stage;
+	bool m_bRunning;
+	std::chrono::steady_clock::time_point m_start;
+	long long m_nInner;			// ns spent in timers nested in this one
+	StageTimer* m_pOuter;
+
+	static thread_local StageTimer* s_pCurrent;
+};
+
+// Times the rest of the enclosing block
+class ScopedTiming {
+public:
+	ScopedTiming(TimingStage stage) : m_timer(stage) { m_timer.start(); }
+	~ScopedTiming() { m_timer.stop(); }
+
+private:
+	StageTimer m_timer;
+};
+
+#endif // FRAME_TIMINGS_H
@@ -16,13 +16,6 @@
 #include "curve.h"
 #include "curveevaluator.h"
 
-#define CURVE_TYPE_LINEAR 0
-#define CURVE_TYPE_BSPLINE 1
-#define CURVE_TYPE_BEZIER 2
-#define CURVE_TYPE_CATMULLROM 3
-#define CURVE_TYPE_C2INTERPOLATING 4
-#define CURVE_TYPE_COUNT 5
-
 #define CURVE_COLOR_COUNT 6
 
 class CurveDomain
@@ -0,0 +1,173 @@
+#include "integrator.h"
+#include "particle.h"
+#include "particleKernels.h"
+#include "threadPool.h"
+
+#include <algorithm>
+
+// particles per work chunk handed to the thread pool
+static const int kIntegratorGrain = 4096;
+
+/*******************
+ * SymplecticEuler
+ *******************/
+
+void SymplecticEuler::step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool)
+{
+	evalForces(particles);
+	pool.parallelFor(particles.size(), kIntegratorGrain, [&particles, h](int begin, int end)
+	{
+		eulerStep(particles, begin, end, h);
+	});
+}
+
+/*******************
+ * VelocityVerlet
+ *******************/
+
+void VelocityVerlet::step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool)
+{
+	int n = particles.size();
+	if (n == 0)
+		return;
+
+	double* p[3] = { &particles.px[0], &particles.py[0], &particles.pz[0] };
+	double* v[3] = { &particles.vx[0], &particles.vy[0], &particles.vz[0] };
+	const double* f[3] = { &particles.fx[0], &particles.fy[0], &particles.fz[0] };
+	const double* m = &particles.mass[0];
+	double half = 0.5 * h;
+
+	// kick and drift; the speed is left at a full Euler step so that
+	// speed dependent forces (drag) are evaluated at a matching speed
+	// rather than the half step one, which would cost an order.  The
+	// forces the last step ended with still hold, unless the kick
+	// after them changed the speed they depend on or the particles
+	// were changed since; n guards against a grown store.
+	if (!m_bReuse || (int)m_half[0].size() != n)
+		evalForces(particles);
+	for (int k = 0; k < 3; ++k)
+		m_half[k].resize(n);
+	pool.parallelFor(n, kIntegratorGrain, [&](int begin, int end)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			double* pk = p[k];
+			double* vk = v[k];
+			double* hk = &m_half[k][0];
+			const double* fk = f[k];
+			for (int i = begin; i < end; ++i)
+			{
+				double kick = fk[i] / m[i] * half;
+				hk[i] = vk[i] + kick;
+				pk[i] += hk[i] * h;
+				vk[i] = hk[i] + kick;
+			}
+		}
+	});
+
+	// second kick with the force at the new positions
+	evalForces(particles);
+	pool.parallelFor(n, kIntegratorGrain, [&](int begin, int end)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			double* vk = v[k];
+			const double* hk = &m_half[k][0];
+			const double* fk = f[k];
+			for (int i = begin; i < end; ++i)
+				vk[i] = hk[i] + fk[i] / m[i] * half;
+		}
+	});
+	m_bReuse = !m_bSpeedDependent;
+}
+
+/*******************
+ * RungeKutta4
+ *******************/
+
+void RungeKutta4::step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool)
+{
+	int n = particles.size();
+	if (n == 0)
+		return;
+
+	std::vector<double>* state[6] = {
+		&particles.px, &particles.py, &particles.pz,
+		&particles.vx, &particles.vy, &particles.vz };
+	for (int c = 0; c < 6; ++c)
+	{
+		m_start[c].resize(n);
+		m_sum[c].resize(n);
+	}
+
+	pool.parallelFor(n, kIntegratorGrain, [&](int begin, int end)
+	{
+		for (int c = 0; c < 6; ++c)
+		{
+			std::copy(state[c]->begin() + begin, state[c]->begin() + end, m_start[c].begin() + begin);
+		}
+	});
+
+	// stage s adds weight * (its speed, its acceleration) to the sums
+	// and moves the store to start + offset * the same; the last stage
+	// moves it to start + h / 6 * sums instead
+	static const double kWeight[4] = { 1.0, 2.0, 2.0, 1.0 };
+	static const double kOffset[4] = { 0.5, 0.5, 1.0, 0.0 };
+
+	for (int s = 0; s < 4; ++s)
+	{
+		evalForces(particles);
+
+		double w = kWeight[s];
+		double offset = kOffset[s] * h;
+		bool bFirst = (s == 0);
+		bool bLast = (s == 3);
+		pool.parallelFor(n, kIntegratorGrain, [&, w, offset, bFirst, bLast](int begin, int end)
+		{
+			const double* f[3] = { &particles.fx[0], &particles.fy[0], &particles.fz[0] };
+			const double* m = &particles.mass[0];
+			double sixth = h / 6.0;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				double* p = &(*state[k])[0];
+				double* v = &(*state[k + 3])[0];
+				const double* p0 = &m_start[k][0];
+				const double* v0 = &m_start[k + 3][0];
+				double* sp = &m_sum[k][0];
+				double* sv = &m_sum[k + 3][0];
+				const double* fk = f[k];
+
+				for (int i = begin; i < end; ++i)
+				{
+					double dp = v[i];
+					double dv = fk[i] / m[i];
+					sp[i] = bFirst ? w * dp : sp[i] + w * dp;
+					sv[i] = bFirst ? w * dv : sv[i] + w * dv;
+					if (bLast)
+					{
+						p[i] = p0[i] + sixth * sp[i];
+						v[i] = v0[i] + sixth * sv[i];
+					}
+					else
+					{
+						p[i] = p0[i] + offset * dp;
+						v[i] = v0[i] + offset * dv;
+					}
+				}
+			}
+		});
+	}
+}
+
+Integrator* createIntegrator(IntegratorType type)
+{
+	switch (type) {
+	case INTEGRATOR_VELOCITY_VERLET:
+		return new VelocityVerlet();
+	case INTEGRATOR_RK4:
+		return new RungeKutta4();
+	default:
+		return new SymplecticEuler();
+	}
+}
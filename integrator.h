@@ -0,0 +1,91 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <vector>
+#include <functional>
+
+class ParticleStore;
+class ThreadPool;
+
+// Fills in the net force of every particle in the store for the
+// positions and speeds it currently holds
+typedef std::function<void(ParticleStore&)> ForceEvaluator;
+
+enum IntegratorType {
+	INTEGRATOR_SYMPLECTIC_EULER = 0,
+	INTEGRATOR_VELOCITY_VERLET,
+	INTEGRATOR_RK4,
+	NUM_INTEGRATOR_TYPES
+};
+
+// Advances a whole particle store by one timestep.  Integrators work
+// column by column on the store's arrays and call back for forces
+// as often as their scheme needs, so a step costs up to evaluations()
+// force passes.  The higher order schemes stay stable and accurate
+// at steps several times longer than Euler's.
+class Integrator {
+public:
+	Integrator() : m_bSpeedDependent(true) {}
+	virtual ~Integrator() {}
+
+	virtual const char* name() const = 0;
+	// force evaluations per step, at most
+	virtual int evaluations() const = 0;
+
+	virtual void step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool) = 0;
+
+	// Whether the forces depend on the particles' speeds (drag), not
+	// just their positions; assumed until told otherwise
+	void setSpeedDependent(bool b) { m_bSpeedDependent = b; }
+	// The particles were added to, moved or slowed down outside
+	// step() since the last one, so forces kept from it are stale
+	virtual void invalidate() {}
+
+protected:
+	bool m_bSpeedDependent;
+};
+
+// speed from the force, then position from the new speed; first
+// order, but keeps orbits and springs from gaining energy
+class SymplecticEuler : public Integrator {
+public:
+	virtual const char* name() const { return "symplectic euler"; }
+	virtual int evaluations() const { return 1; }
+	virtual void step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool);
+};
+
+// kick half a step, drift a whole step, kick again with the force at
+// the new positions; second order and time reversible.  Unless they
+// depend on speed, the forces of the second kick are those at the
+// start of the next step, and are reused there: one evaluation a
+// step rather than two.
+class VelocityVerlet : public Integrator {
+public:
+	VelocityVerlet() : m_bReuse(false) {}
+	virtual const char* name() const { return "velocity verlet"; }
+	virtual int evaluations() const { return 2; }
+	virtual void step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool);
+	virtual void invalidate() { m_bReuse = false; }
+
+private:
+	std::vector<double> m_half[3];		// half step speed
+	bool m_bReuse;						// the store's forces are those of its state
+};
+
+// classic fourth order Runge-Kutta
+class RungeKutta4 : public Integrator {
+public:
+	virtual const char* name() const { return "rk4"; }
+	virtual int evaluations() const { return 4; }
+	virtual void step(ParticleStore& particles, double h, const ForceEvaluator& evalForces, ThreadPool& pool);
+
+private:
+	// state at the start of the step and the weighted sums of the
+	// stage derivatives: px py pz vx vy vz
+	std::vector<double> m_start[6];
+	std::vector<double> m_sum[6];
+};
+
+Integrator* createIntegrator(IntegratorType type);
+
+#endif // INTEGRATOR_H
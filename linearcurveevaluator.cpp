@@ -1,19 +1,45 @@
-#include "LinearCurveEvaluator.h"
+#include "linearcurveevaluator.h"
 #include <assert.h>
 
-void LinearCurveEvaluator::evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-										 std::vector<Point>& ptvEvaluatedCurvePts, 
-										 const float& fAniLength, 
-										 const bool& bWrap,
-										 const bool& bApative,
-										 const double& dTension) const
+#include <algorithm>
+
+int LinearCurveEvaluator::pieceCount(const std::vector<Point>& ptvCtrlPts,
+									 const bool& bWrap) const
 {
-	int iCtrlPtCount = ptvCtrlPts.size();
+	return std::max((int)ptvCtrlPts.size() - 1, 0);
+}
+
+void LinearCurveEvaluator::evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+										  std::vector<CurveSegment>& pieces,
+										  const int iFirst,
+										  const int iLast,
+										  const float& fAniLength,
+										  const bool& bWrap,
+										  const double& dTension) const
+{
+	for (int i = iFirst; i <= iLast; ++i)
+		pieces[i].setLine(ptvCtrlPts[i], ptvCtrlPts[i + 1]);
+}
 
-	ptvEvaluatedCurvePts.assign(ptvCtrlPts.begin(), ptvCtrlPts.end());
+void LinearCurveEvaluator::affectedPieces(const std::vector<Point>& ptvCtrlPts,
+										  const int iFirstCtrlPt,
+										  const int iLastCtrlPt,
+										  const bool& bWrap,
+										  int& iFirst,
+										  int& iLast) const
+{
+	// a line either side of each point
+	iFirst = std::max(iFirstCtrlPt - 1, 0);
+	iLast = std::min(iLastCtrlPt, pieceCount(ptvCtrlPts, bWrap) - 1);
+}
 
-	float x = 0.0;
-	float y1;
+void LinearCurveEvaluator::endValues(const std::vector<Point>& ptvCtrlPts,
+									 const float& fAniLength,
+									 const bool& bWrap,
+									 float& y1,
+									 float& y2) const
+{
+	int iCtrlPtCount = ptvCtrlPts.size();
 
 	if (bWrap) {
 		// if wrapping is on, interpolate the y value at xmin and
@@ -27,23 +53,13 @@ void LinearCurveEvaluator::evaluateCurve(const std::vector<Point>& ptvCtrlPts,
 		}
 		else 
 			y1 = ptvCtrlPts[0].y;
+		y2 = y1;
 	}
 	else {
 		// if wrapping is off, make the first and last segments of
 		// the curve horizontal.
 
 		y1 = ptvCtrlPts[0].y;
-    }
-
-	ptvEvaluatedCurvePts.push_back(Point(x, y1));
-
-	/// set the endpoint based on the wrap flag.
-	float y2;
-    x = fAniLength;
-    if (bWrap)
-		y2 = y1;
-    else
 		y2 = ptvCtrlPts[iCtrlPtCount - 1].y;
-
-	ptvEvaluatedCurvePts.push_back(Point(x, y2));
+	}
 }
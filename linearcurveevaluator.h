@@ -3,19 +3,33 @@
 
 #pragma warning(disable : 4786)  
 
-#include "CurveEvaluator.h"
+#include "curveevaluator.h"
 
 //using namespace std;
 
 class LinearCurveEvaluator : public CurveEvaluator
 {
 public:
-	void evaluateCurve(const std::vector<Point>& ptvCtrlPts, 
-		std::vector<Point>& ptvEvaluatedCurvePts, 
-		const float& fAniLength, 
+	int pieceCount(const std::vector<Point>& ptvCtrlPts,
+		const bool& bWrap) const;
+	void evaluatePieces(const std::vector<Point>& ptvCtrlPts,
+		std::vector<CurveSegment>& pieces,
+		const int iFirst,
+		const int iLast,
+		const float& fAniLength,
 		const bool& bWrap,
-		const bool& bAdaptive,
 		const double& dTension) const;
+	void affectedPieces(const std::vector<Point>& ptvCtrlPts,
+		const int iFirstCtrlPt,
+		const int iLastCtrlPt,
+		const bool& bWrap,
+		int& iFirst,
+		int& iLast) const;
+	void endValues(const std::vector<Point>& ptvCtrlPts,
+		const float& fAniLength,
+		const bool& bWrap,
+		float& fStartY,
+		float& fEndY) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "mappedFile.h"
+
+#include <algorithm>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	m_pData(NULL),
+	m_uSize(0)
+#ifdef WIN32
+	, m_hFile(INVALID_HANDLE_VALUE),
+	m_hMapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::swap(MappedFile& other)
+{
+	std::swap(m_pData, other.m_pData);
+	std::swap(m_uSize, other.m_uSize);
+#ifdef WIN32
+	std::swap(m_hFile, other.m_hFile);
+	std::swap(m_hMapping, other.m_hMapping);
+#endif
+}
+
+#ifdef WIN32
+
+bool MappedFile::open(const char* szFileName)
+{
+	close();
+
+	HANDLE hFile = CreateFileA(szFileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER liSize;
+	if (!GetFileSizeEx(hFile, &liSize) || liSize.QuadPart == 0 ||
+		(unsigned long long)liSize.QuadPart > (size_t)-1) {
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL) {
+		CloseHandle(hFile);
+		return false;
+	}
+
+	void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (pView == NULL) {
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pData = (const unsigned char*)pView;
+	m_uSize = (size_t)liSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle((HANDLE)m_hMapping);
+	if (m_hFile != INVALID_HANDLE_VALUE)
+		CloseHandle((HANDLE)m_hFile);
+
+	m_pData = NULL;
+	m_uSize = 0;
+	m_hMapping = NULL;
+	m_hFile = INVALID_HANDLE_VALUE;
+}
+
+#else // WIN32
+
+bool MappedFile::open(const char* szFileName)
+{
+	close();
+
+	int fd = ::open(szFileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* pView = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file alive on its own
+	::close(fd);
+	if (pView == MAP_FAILED)
+		return false;
+
+	madvise(pView, st.st_size, MADV_RANDOM);
+	m_pData = (const unsigned char*)pView;
+	m_uSize = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_pData)
+		munmap((void*)m_pData, m_uSize);
+
+	m_pData = NULL;
+	m_uSize = 0;
+}
+
+#endif // WIN32
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.  Pages are brought in by
+// the OS as they are touched and can be dropped again under memory
+// pressure, so large files cost address space rather than RAM.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char* szFileName);
+	void close();
+	// Exchanges mappings; views into either stay valid
+	void swap(MappedFile& other);
+
+	bool isOpen() const { return m_pData != NULL; }
+	const unsigned char* data() const { return m_pData; }
+	size_t size() const { return m_uSize; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* m_pData;
+	size_t m_uSize;
+#ifdef WIN32
+	void* m_hFile;
+	void* m_hMapping;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -1,6 +1,9 @@
 #ifndef __MATRIX_HEADER__
 #define __MATRIX_HEADER__
 
+#include <string.h>
+#include <math.h>
+
 //==========[ Forward References ]=============================================
 
 template <class T> class Vec;
@@ -54,7 +57,7 @@ public:
 
 	//---[ Ordering Methods ]------------------------------
 
-	Mat3<T> transpose() const { return Mat3<T>(n[0],n[3],n[6],n[1],n[4],n[7],n[2],n[5],n[8]) }
+	Mat3<T> transpose() const { return Mat3<T>(n[0],n[3],n[6],n[1],n[4],n[7],n[2],n[5],n[8]); }
 	double trace() const { return n[0]+n[4]+n[8]; }
 	
 	//---[ GL Matrix ]-------------------------------------
@@ -73,7 +76,7 @@ public:
 
 	//---[ Friend Methods ]--------------------------------
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
         template <class U> friend Mat3<U> operator -( const Mat3<U>& a );
 	template <class U> friend Mat3<U> operator +( const Mat3<U>& a, const Mat3<U>& b );
@@ -245,7 +248,7 @@ public:
 	
 	//---[ Friend Methods ]--------------------------------
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
 	template <class U> friend Mat4<U> operator -( const Mat4<U>& a );
 	template <class U> friend Mat4<U> operator +( const Mat4<U>& a, const Mat4<U>& b );
@@ -320,14 +323,14 @@ template <class T>
 inline Mat3<T> operator +( const Mat3<T>& a, const Mat3<T>& b ) {
 	return Mat3<T>( a.n[0]+b.n[0], a.n[1]+b.n[1], a.n[2]+b.n[2],
 					a.n[3]+b.n[3], a.n[4]+b.n[4], a.n[5]+b.n[5],
-					a.n[6]+b.n[6], a.n[7]+b.n[7], a.n[8]+b.n[8],);
+					a.n[6]+b.n[6], a.n[7]+b.n[7], a.n[8]+b.n[8]);
 }
 
 template <class T>
 inline Mat3<T> operator -( const Mat3<T>& a, const Mat3<T>& b) {
 	return Mat3<T>( a.n[0]-b.n[0], a.n[1]-b.n[1], a.n[2]-b.n[2],
 					a.n[3]-b.n[3], a.n[4]-b.n[4], a.n[5]-b.n[5],
-					a.n[6]-b.n[6], a.n[7]-b.n[7], a.n[8]-b.n[8],);
+					a.n[6]-b.n[6], a.n[7]-b.n[7], a.n[8]-b.n[8]);
 }
 
 template <class T>
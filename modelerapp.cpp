@@ -189,6 +189,13 @@ void ModelerApplication::ValueChangedCallback()
 			// otherwise, we sync the psystem
 			// to the ui
 			else if (m_ui->simulate()) {
+				ps->setBakeFps((float)m_ui->fps());
+				// the simulation reads the controls off its own copy
+				// of the curves, which the graphs can't change under it
+				ControlCurves& controls = ps->getControls();
+				controls.clear();
+				for (int i = 0; i < m_app->m_numControls; ++i)
+					controls.add(*m_ui->m_pwndGraphWidget->curve(i));
 				ps->startSimulation(currTime);
 			} else {
 				ps->stopSimulation(currTime);
@@ -208,6 +215,11 @@ void ModelerApplication::RedrawLoop(void*)
 	if (ModelerApplication::Instance()->m_animating)
 		ModelerApplication::Instance()->m_ui->redrawModelerView();
 
+	// a bake thread moves the end of the baked range between redraws
+	ParticleSystem *ps = ModelerApplication::Instance()->GetParticleSystem();
+	if (ps != NULL && ps->isSimulate())
+		ModelerApplication::Instance()->m_ui->updateRangeMarker();
+
 	// 1/50 second update is good enough
 	Fl::add_timeout(0.025, ModelerApplication::RedrawLoop, NULL);
 }
\ No newline at end of file
@@ -62,6 +62,13 @@ inline void ModelerUI::cb_saveAniScript_i(Fl_Menu_*, void*)
 			// save the camera keyframes
 			string strCamKeyframeFileName = strFileName + ".cam";
 			m_pwndModelerView->m_curve_camera->saveKeyframes(strCamKeyframeFileName.c_str());
+			// and the baked particles, if there are any
+			ParticleSystem* ps = ModelerApplication::Instance()->GetParticleSystem();
+			if (ps && ps->isBakedAt(ps->getBakeStartTime())) {
+				string strBakeCacheFileName = strFileName + ".pcache";
+				if (!ps->saveBakeCache(strBakeCacheFileName.c_str()))
+					fl_alert("Sorry! I can't save the baked particles!");
+			}
 		}
 		else {
 			fl_alert("Sorry! I can't save the animation script!");
@@ -707,19 +714,23 @@ void ModelerUI::currTime(float fTime)
 	if (m_pcbfValueChangedCallback)
 		m_pcbfValueChangedCallback();
 
-	if (simulate()) {
-		// update indicator window for particle simulation range
+	if (simulate())
+		updateRangeMarker();
+}
 
-		ParticleSystem *ps = ModelerApplication::Instance()->GetParticleSystem();
+void ModelerUI::updateRangeMarker()
+{
+	// update indicator window for particle simulation range
 
-		if (ps != NULL) {
-			float bakeStartTime = ModelerApplication::Instance()->GetParticleSystem()->getBakeStartTime();
-			float bakeEndTime = ModelerApplication::Instance()->GetParticleSystem()->getBakeEndTime();
-			if (bakeEndTime < 0.0f)
-				bakeEndTime = fTime;
-			indicatorRangeMarkerRange(bakeStartTime, bakeEndTime);
+	ParticleSystem *ps = ModelerApplication::Instance()->GetParticleSystem();
 
-		}
+	if (ps != NULL) {
+		float bakeStartTime = ps->getBakeStartTime();
+		float bakeEndTime = ps->getBakeEndTime();
+		if (bakeEndTime < 0.0f)
+			bakeEndTime = currTime();
+		indicatorRangeMarkerRange(bakeStartTime, bakeEndTime);
+		m_pwndIndicatorWnd->redraw();
 	}
 }
 
@@ -814,8 +825,9 @@ float ModelerUI::controlValue(int iControl) const
 		return valueSlider(iControl)->value();
 	}
 	else {
-		// curve mode
-		return m_pwndGraphWidget->curve(iControl)->evaluateCurveAt(m_pwndGraphWidget->currTime());
+		// curve mode: every control is read off the curves at once,
+		// the first time any is asked for at this time
+		return m_curveBank.value(iControl, m_pwndGraphWidget->currTime());
 	}
 }
 
@@ -1020,7 +1032,8 @@ void ModelerUI::addControl(const char* szName, float fMin, float fMax, float fSt
 	m_pbrsBrowser->add(strName.c_str());
 	
 	// Setup the curve
-	m_pwndGraphWidget->addCurve(fInitVal, fMin, fMax);
+	int iCurve = m_pwndGraphWidget->addCurve(fInitVal, fMin, fMax);
+	m_curveBank.add(m_pwndGraphWidget->curve(iCurve));
 
 	++m_iCurrControlCount;
 }
@@ -1048,6 +1061,15 @@ bool ModelerUI::openAniScript(const char* szFileName)
 		m_pwndIndicatorWnd->clearIndicators();
 		for (int ikf = 0; ikf < m_pwndModelerView->m_curve_camera->numKeyframes(); ++ikf)
 			m_pwndIndicatorWnd->addIndicator(m_pwndModelerView->m_curve_camera->keyframeTime(ikf));
+		// load the baked particles, playing back at the rate they were baked at
+		ParticleSystem* ps = ModelerApplication::Instance()->GetParticleSystem();
+		string strBakeCacheFileName = szFileName;
+		strBakeCacheFileName += ".pcache";
+		if (ps && ps->loadBakeCache(strBakeCacheFileName.c_str())) {
+			m_psldrFPS->value(ps->getBakeFps());
+			fps((int)m_psldrFPS->value());
+			indicatorRangeMarkerRange(ps->getBakeStartTime(), ps->getBakeEndTime());
+		}
 
 		return true;
 	}
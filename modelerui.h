@@ -12,6 +12,7 @@
 #include "modelerdraw.h"
 #include "modelerapp.h"
 #include "particleSystem.h"
+#include "curveBank.h"
 #include "modeleruiwindows.h"
 
 class ModelerUI : public ModelerUIWindows
@@ -40,6 +41,8 @@ public:
 	
 	bool simulate() const;
 	void simulate(bool bSimulate);
+	// shows the baked range of the particle system above the time slider
+	void updateRangeMarker();
 	void redrawModelerView();
     void autoLoadNPlay();
 
@@ -65,6 +68,9 @@ private:
 	std::string m_strMovieFileName;
 	int m_iMovieFrameNum;
 
+	// the curves' values at the current time, for controlValue()
+	mutable CurveBank m_curveBank;
+
 	inline void cb_openAniScript_i(Fl_Menu_*, void*);
 	static void cb_openAniScript(Fl_Menu_*, void*);
 	inline void cb_saveAniScript_i(Fl_Menu_*, void*);
@@ -3,10 +3,13 @@
 #include "bitmap.h"
 #include "modelerapp.h"
 #include "particleSystem.h"
+#include "frameTimings.h"
 
 #include <FL/Fl.H>
 #include <FL/Fl_Gl_Window.h>
 #include <FL/gl.h>
+#include <FL/Fl_File_Chooser.H>
+#include <FL/fl_ask.h>
 #include <GL/glu.h>
 #include <cstdio>
 
@@ -17,7 +20,7 @@ static const int	kMouseZoomButton				= FL_RIGHT_MOUSE;
 static const char *bmp_name = NULL;
 
 ModelerView::ModelerView(int x, int y, int w, int h, char *label)
-: Fl_Gl_Window(x,y,w,h,label), t(0), save_bmp(false) 
+: Fl_Gl_Window(x,y,w,h,label), t(0), save_bmp(false), show_timings(false), draw_timer(TIMING_DRAW)
 {
 	m_ctrl_camera = new Camera();
 	m_curve_camera = new Camera();
@@ -80,6 +83,21 @@ int ModelerView::handle(int event)
           //  printf("release %d %d\n", eventCoordX, eventCoordY);
 		}
 		break;
+	case FL_SHORTCUT:
+		{
+			switch (Fl::event_key())
+			{
+			case FL_F + 2:
+				show_timings = !show_timings;
+				break;
+			case FL_F + 3:
+				toggleTimingsCsv();
+				break;
+			default:
+				return Fl_Gl_Window::handle(event);
+			}
+		}
+		break;
 	default:
 		return Fl_Gl_Window::handle(event);
 	}
@@ -97,6 +115,11 @@ static GLfloat lightDiffuse1[]  = { 1, 1, 1, 1 };
 
 void ModelerView::draw()
 {
+	// a subclass that never called endDraw() leaves the last frame's
+	// timer running
+	draw_timer.stop();
+	draw_timer.start();
+
     if (!valid())
     {
         glShadeModel( GL_SMOOTH );
@@ -148,10 +171,75 @@ void ModelerView::camera(cam_mode_t mode)
 /** Cleanup fxn for saving bitmaps **/
 void ModelerView::endDraw()
 {
-	if ((bmp_name == NULL) || (!save_bmp)) return;
-	glFinish();
-	saveBMP(bmp_name);
-	save_bmp = false;
+	if ((bmp_name != NULL) && save_bmp) {
+		glFinish();
+		saveBMP(bmp_name);
+		save_bmp = false;
+	}
+	draw_timer.stop();
+
+	// after the bitmap is saved, so movies don't show it
+	if (show_timings)
+		drawTimings();
+	FrameTimings::instance().endFrame();
+}
+
+void ModelerView::toggleTimingsCsv()
+{
+	FrameTimings& timings = FrameTimings::instance();
+	if (timings.csvOpen()) {
+		timings.stopCsv();
+		return;
+	}
+
+	char *szFileName = fl_file_chooser("Record Frame Timings To", "*.csv", NULL);
+	if (szFileName && !timings.startCsv(szFileName))
+		fl_alert("Sorry! I can't record the frame timings!");
+}
+
+/** The frame timings of the last few seconds, over the scene **/
+void ModelerView::drawTimings()
+{
+	FrameTimings& timings = FrameTimings::instance();
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, w(), 0, h(), -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	gl_font(FL_COURIER, 12);
+	int lineHeight = gl_height();
+	int yy = h() - lineHeight;
+	char szLine[64];
+
+	glColor3f(1, 1, 0);
+	double frameMs = timings.averageFrameMs();
+	sprintf(szLine, "frame    %7.2f ms %5.1f fps", frameMs, frameMs > 0 ? 1000 / frameMs : 0.0);
+	gl_draw(szLine, 8, yy);
+	for (int i = 0; i < TIMING_STAGE_COUNT; ++i) {
+		yy -= lineHeight;
+		sprintf(szLine, "%-8s %7.2f ms (last %.2f)", FrameTimings::stageName((TimingStage)i),
+			timings.averageMs((TimingStage)i), timings.lastMs((TimingStage)i));
+		gl_draw(szLine, 8, yy);
+	}
+	if (timings.csvOpen()) {
+		yy -= lineHeight;
+		glColor3f(1, 0, 0);
+		gl_draw("recording to csv", 8, yy);
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopAttrib();
 }
 
 
@@ -163,6 +251,8 @@ void ModelerView::setBMP(const char *fname)
 
 void ModelerView::saveBMP(const char* szFileName)
 {
+	ScopedTiming timing(TIMING_SAVE_BMP);
+
 	int xx = x();
 	int yy = y();
 	int ww = w();
@@ -11,6 +11,8 @@
 
 #include <FL/Fl_Gl_Window.H>
 
+#include "frameTimings.h"
+
 class Camera;
 class ModelerView;
 typedef ModelerView* (*ModelerViewCreator_f)(int x, int y, int w, int h, char *label);
@@ -38,6 +40,16 @@ public:
 	float t;
 	void update();
 	bool save_bmp;
+
+	// F2 shows where each frame's time goes, F3 starts or stops
+	// recording it to a CSV file
+	bool show_timings;
+
+private:
+	void toggleTimingsCsv();
+	void drawTimings();
+
+	StageTimer draw_timer;
 };
 
 
@@ -0,0 +1,204 @@
+#include "octree.h"
+#include "particle.h"
+
+#include <math.h>
+
+// particles closer together than this are never split further
+static const int kMaxDepth = 32;
+// deepest possible traversal stack: every level can push 8 children
+static const int kStackSize = 8 * kMaxDepth + 8;
+
+Octree::Octree()
+{
+}
+
+void Octree::clear()
+{
+	m_nodes.clear();
+	m_bodies.clear();
+}
+
+void Octree::build(const ParticleStore& particles)
+{
+	clear();
+
+	int n = particles.size();
+	m_bodies.reserve(particles.liveCount());
+	double lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+	for (int i = 0; i < n; ++i)
+	{
+		if (!particles.alive(i))
+			continue;
+
+		Body b = { particles.px[i], particles.py[i], particles.pz[i], particles.mass[i], i };
+		double p[3] = { b.x, b.y, b.z };
+		for (int k = 0; k < 3; ++k)
+		{
+			if (m_bodies.empty() || p[k] < lo[k]) lo[k] = p[k];
+			if (m_bodies.empty() || p[k] > hi[k]) hi[k] = p[k];
+		}
+		m_bodies.push_back(b);
+	}
+	if (m_bodies.empty())
+		return;
+
+	double half = 0.0;
+	for (int k = 0; k < 3; ++k)
+	{
+		if (0.5 * (hi[k] - lo[k]) > half)
+			half = 0.5 * (hi[k] - lo[k]);
+	}
+	// a touch of slack so the extremes fall strictly inside
+	half = half * 1.0001 + 1e-9;
+
+	m_scratch.resize(m_bodies.size());
+	m_nodes.reserve(2 * m_bodies.size() / kLeafSize + 1);
+	m_nodes.resize(1);
+	buildNode(0, 0, (int)m_bodies.size(),
+		0.5 * (lo[0] + hi[0]), 0.5 * (lo[1] + hi[1]), 0.5 * (lo[2] + hi[2]), half, 0);
+}
+
+void Octree::buildNode(int iNode, int begin, int end, double ox, double oy, double oz, double half, int depth)
+{
+	{
+		Node& node = m_nodes[iNode];
+		node.ox = ox; node.oy = oy; node.oz = oz; node.half = half;
+		node.begin = begin; node.end = end;
+		node.firstChild = -1;
+		node.childCount = 0;
+	}
+
+	if (end - begin <= kLeafSize || depth >= kMaxDepth)
+	{
+		double m = 0, cx = 0, cy = 0, cz = 0;
+		for (int i = begin; i < end; ++i)
+		{
+			const Body& b = m_bodies[i];
+			m += b.m;
+			cx += b.m * b.x;
+			cy += b.m * b.y;
+			cz += b.m * b.z;
+		}
+		Node& node = m_nodes[iNode];
+		node.mass = m;
+		node.cx = (m > 0) ? cx / m : ox;
+		node.cy = (m > 0) ? cy / m : oy;
+		node.cz = (m > 0) ? cz / m : oz;
+		return;
+	}
+
+	// counting sort of the bodies into octants
+	int count[8] = { 0 };
+	for (int i = begin; i < end; ++i)
+	{
+		const Body& b = m_bodies[i];
+		++count[(b.x >= ox) | ((b.y >= oy) << 1) | ((b.z >= oz) << 2)];
+	}
+	int start[9];
+	start[0] = begin;
+	for (int o = 0; o < 8; ++o)
+		start[o + 1] = start[o] + count[o];
+	int cursor[8];
+	for (int o = 0; o < 8; ++o)
+		cursor[o] = start[o];
+	for (int i = begin; i < end; ++i)
+	{
+		const Body& b = m_bodies[i];
+		m_scratch[cursor[(b.x >= ox) | ((b.y >= oy) << 1) | ((b.z >= oz) << 2)]++] = b;
+	}
+	for (int i = begin; i < end; ++i)
+		m_bodies[i] = m_scratch[i];
+
+	// allocate the non-empty children side by side, then fill them in
+	int iFirst = (int)m_nodes.size();
+	int nChildren = 0;
+	for (int o = 0; o < 8; ++o)
+		nChildren += (count[o] > 0);
+	m_nodes.resize(iFirst + nChildren);
+	m_nodes[iNode].firstChild = iFirst;
+	m_nodes[iNode].childCount = nChildren;
+
+	double quarter = 0.5 * half;
+	int iChild = iFirst;
+	for (int o = 0; o < 8; ++o)
+	{
+		if (count[o] == 0)
+			continue;
+		buildNode(iChild++, start[o], start[o + 1],
+			ox + ((o & 1) ? quarter : -quarter),
+			oy + ((o & 2) ? quarter : -quarter),
+			oz + ((o & 4) ? quarter : -quarter),
+			quarter, depth + 1);
+	}
+
+	double m = 0, cx = 0, cy = 0, cz = 0;
+	for (int c = iFirst; c < iFirst + nChildren; ++c)
+	{
+		const Node& child = m_nodes[c];
+		m += child.mass;
+		cx += child.mass * child.cx;
+		cy += child.mass * child.cy;
+		cz += child.mass * child.cz;
+	}
+	Node& node = m_nodes[iNode];
+	node.mass = m;
+	node.cx = (m > 0) ? cx / m : ox;
+	node.cy = (m > 0) ? cy / m : oy;
+	node.cz = (m > 0) ? cz / m : oz;
+}
+
+void Octree::field(double x, double y, double z, int self, double theta, double eps2,
+				   double& gx, double& gy, double& gz) const
+{
+	gx = gy = gz = 0.0;
+	if (m_nodes.empty())
+		return;
+
+	const double theta2 = theta * theta;
+	int stack[kStackSize];
+	int nStack = 0;
+	stack[nStack++] = 0;
+
+	while (nStack > 0)
+	{
+		const Node& node = m_nodes[stack[--nStack]];
+
+		double dx = node.cx - x, dy = node.cy - y, dz = node.cz - z;
+		double d2 = dx * dx + dy * dy + dz * dz;
+		double side = 2.0 * node.half;
+		bool bInside = fabs(x - node.ox) <= node.half && fabs(y - node.oy) <= node.half &&
+			fabs(z - node.oz) <= node.half;
+
+		if (!bInside && side * side < theta2 * d2)
+		{
+			// far enough away to count as one mass
+			double r2 = d2 + eps2;
+			double s = node.mass / (r2 * sqrt(r2));
+			gx += dx * s;
+			gy += dy * s;
+			gz += dz * s;
+		}
+		else if (node.firstChild < 0)
+		{
+			for (int i = node.begin; i < node.end; ++i)
+			{
+				const Body& b = m_bodies[i];
+				if (b.index == self)
+					continue;
+				double bx = b.x - x, by = b.y - y, bz = b.z - z;
+				double r2 = bx * bx + by * by + bz * bz + eps2;
+				if (r2 == 0.0)
+					continue;
+				double s = b.m / (r2 * sqrt(r2));
+				gx += bx * s;
+				gy += by * s;
+				gz += bz * s;
+			}
+		}
+		else
+		{
+			for (int c = node.childCount - 1; c >= 0; --c)
+				stack[nStack++] = node.firstChild + c;
+		}
+	}
+}
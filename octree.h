@@ -0,0 +1,53 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <vector>
+
+class ParticleStore;
+
+// Octree over the live particles of a store, for Barnes-Hut sums of
+// inverse square fields.  Every node keeps the total mass and the
+// centre of mass of the particles below it; a query treats a node
+// as a single point mass once it looks small enough from the query
+// point (side / distance < theta) and opens it otherwise, so a sum
+// over n particles costs O(log n) instead of O(n).  theta = 0 opens
+// every node and gives the exact sum.
+class Octree {
+public:
+	Octree();
+
+	void build(const ParticleStore& particles);
+	void clear();
+
+	int nodeCount() const { return (int)m_nodes.size(); }
+
+	// Sum over particles j other than self of
+	//   m_j * (p_j - p) / (|p_j - p|^2 + eps2)^(3/2)
+	// i.e. the gravitational field at p for G = 1, softened by eps2
+	void field(double x, double y, double z, int self, double theta, double eps2,
+			   double& gx, double& gy, double& gz) const;
+
+	// leaves hold up to this many particles, summed directly
+	static const int kLeafSize = 8;
+
+private:
+	struct Body {
+		double x, y, z, m;
+		int index;
+	};
+	struct Node {
+		double cx, cy, cz, mass;		// centre of mass, total mass
+		double ox, oy, oz, half;		// cube centre and half side
+		int firstChild;					// children are contiguous; -1 for a leaf
+		int childCount;
+		int begin, end;					// bodies below the node
+	};
+
+	void buildNode(int iNode, int begin, int end, double ox, double oy, double oz, double half, int depth);
+
+	std::vector<Node> m_nodes;
+	std::vector<Body> m_bodies;			// grouped by leaf
+	std::vector<Body> m_scratch;
+};
+
+#endif // OCTREE_H
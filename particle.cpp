@@ -1,33 +1,168 @@
- // SAMPLE_SOLUTION
 #include "particle.h"
-#include "modelerdraw.h"
-#include <FL/gl.h>
-#include <FL/glut.h>
-#include <GL/glu.h>
 #include <cstdio>
 #include <math.h>
-#include "Force.h"
+#include <algorithm>
 
-void Particle::add_force(Force* f) {
-	forces.push_back(f);
+const float ParticleStore::kImmortal = FLT_MAX;
+
+// dead slots below this many are never worth a compaction pass
+static const int kMinCompactSlots = 256;
+
+int ParticleStore::add(const Vec3d& p, const Vec3d& s, double m, float fLifetime)
+{
+	if (m_freeSlots.empty())
+	{
+		px.push_back(p[0]); py.push_back(p[1]); pz.push_back(p[2]);
+		vx.push_back(s[0]); vy.push_back(s[1]); vz.push_back(s[2]);
+		fx.push_back(0.0); fy.push_back(0.0); fz.push_back(0.0);
+		mass.push_back(m);
+		age.push_back(0.0f);
+		lifetime.push_back(fLifetime);
+		id.push_back(m_uNextId++);
+		return size() - 1;
+	}
+
+	int i = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	setPos(i, p);
+	setSpeed(i, s);
+	setNetForce(i, Vec3d(0, 0, 0));
+	mass[i] = m;
+	age[i] = 0.0f;
+	lifetime[i] = fLifetime;
+	id[i] = m_uNextId++;
+	return i;
+}
+
+void ParticleStore::kill(int i)
+{
+	if (!alive(i))
+		return;
+	id[i] = kDeadId;
+	// a dead slot still gets integrated; stopped here and left
+	// without force by ParticleSystem, it stays where it died
+	setSpeed(i, Vec3d(0, 0, 0));
+	m_freeSlots.push_back(i);
+}
+
+int ParticleStore::expire(double dt)
+{
+	int iKilled = 0;
+	int n = size();
+	for (int i = 0; i < n; ++i)
+	{
+		if (id[i] == kDeadId)
+			continue;
+		age[i] += (float)dt;
+		if (age[i] > lifetime[i])
+		{
+			kill(i);
+			++iKilled;
+		}
+	}
+	return iKilled;
+}
+
+bool ParticleStore::compact(bool bForce)
+{
+	int iDead = (int)m_freeSlots.size();
+	if (iDead == 0)
+		return false;
+	if (!bForce && (iDead < kMinCompactSlots || iDead * 4 < size()))
+		return false;
+
+	// fill the lowest holes with the highest live particles
+	std::sort(m_freeSlots.begin(), m_freeSlots.end());
+	int iLive = size() - iDead;
+	int iSrc = size() - 1;
+	for (std::vector<int>::const_iterator it = m_freeSlots.begin(); it != m_freeSlots.end() && *it < iLive; ++it)
+	{
+		while (id[iSrc] == kDeadId)
+			--iSrc;
+		int iDst = *it;
+		px[iDst] = px[iSrc]; py[iDst] = py[iSrc]; pz[iDst] = pz[iSrc];
+		vx[iDst] = vx[iSrc]; vy[iDst] = vy[iSrc]; vz[iDst] = vz[iSrc];
+		fx[iDst] = fx[iSrc]; fy[iDst] = fy[iSrc]; fz[iDst] = fz[iSrc];
+		mass[iDst] = mass[iSrc];
+		age[iDst] = age[iSrc];
+		lifetime[iDst] = lifetime[iSrc];
+		id[iDst] = id[iSrc];
+		--iSrc;
+	}
+
+	m_freeSlots.clear();
+	resize(iLive);
+	return true;
 }
 
-void Particle::nextPos(float deltaT) {
-	for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
+void ParticleStore::rebuildFreeList()
+{
+	m_freeSlots.clear();
+	unsigned int uMaxId = 0;
+	for (int i = size() - 1; i >= 0; --i)
 	{
-		(*it)->addForce(this);
+		if (id[i] == kDeadId)
+			m_freeSlots.push_back(i);
+		else if (id[i] > uMaxId)
+			uMaxId = id[i];
 	}
-	speed += netForce/mass * deltaT;
-	position += speed * deltaT;
-}
-
-void Particle::draw() {
-	setDiffuseColor(0,0,1);
-	glPushMatrix();
-	glPointSize(5);
-	glBegin(GL_POINTS);
-	glVertex3f(position[0], position[1], position[2]);
-	glEnd();
-	glPopMatrix();
-	glPointSize(1);
-}
\ No newline at end of file
+	m_uNextId = uMaxId + 1;
+}
+
+void ParticleStore::reserve(int n)
+{
+	px.reserve(n); py.reserve(n); pz.reserve(n);
+	vx.reserve(n); vy.reserve(n); vz.reserve(n);
+	fx.reserve(n); fy.reserve(n); fz.reserve(n);
+	mass.reserve(n);
+	age.reserve(n); lifetime.reserve(n); id.reserve(n);
+}
+
+void ParticleStore::resize(int n)
+{
+	px.resize(n); py.resize(n); pz.resize(n);
+	vx.resize(n); vy.resize(n); vz.resize(n);
+	fx.resize(n); fy.resize(n); fz.resize(n);
+	mass.resize(n);
+	age.resize(n); lifetime.resize(n); id.resize(n);
+}
+
+void ParticleStore::clear()
+{
+	px.clear(); py.clear(); pz.clear();
+	vx.clear(); vy.clear(); vz.clear();
+	fx.clear(); fy.clear(); fz.clear();
+	mass.clear();
+	age.clear(); lifetime.clear(); id.clear();
+	m_freeSlots.clear();
+	m_uNextId = 1;
+}
+
+void ParticleStore::clearForces()
+{
+	std::fill(fx.begin(), fx.end(), 0.0);
+	std::fill(fy.begin(), fy.end(), 0.0);
+	std::fill(fz.begin(), fz.end(), 0.0);
+}
+
+void ParticleStore::clearForces(int begin, int end)
+{
+	std::fill(fx.begin() + begin, fx.begin() + end, 0.0);
+	std::fill(fy.begin() + begin, fy.begin() + end, 0.0);
+	std::fill(fz.begin() + begin, fz.begin() + end, 0.0);
+}
+
+ParticleSpan ParticleStore::span(int begin, int end)
+{
+	ParticleSpan s;
+	s.count = end - begin;
+	s.px = &px[0] + begin; s.py = &py[0] + begin; s.pz = &pz[0] + begin;
+	s.vx = &vx[0] + begin; s.vy = &vy[0] + begin; s.vz = &vz[0] + begin;
+	s.mass = &mass[0] + begin;
+	s.id = &id[0] + begin;
+	s.fx = &fx[0] + begin; s.fy = &fy[0] + begin; s.fz = &fz[0] + begin;
+	s.begin = begin;
+	s.store = this;
+	s.grid = NULL;
+	return s;
+}
@@ -4,32 +4,110 @@
 
 #include "vec.h"
 #include <vector>
-#include <map>
+#include <float.h>
 
-class Force;
+class ParticleStore;
+class SpatialGrid;
 
-class Particle {
+// A contiguous run of particles, handed to forces and kernels in
+// one call.  Each pointer addresses the first particle of the run
+// in the matching ParticleStore column; forces that need other
+// particles than their own index the whole store, where the run
+// starts at begin.
+struct ParticleSpan {
+	int count;
+	const double *px, *py, *pz;
+	const double *vx, *vy, *vz;
+	const double *mass;
+	const unsigned int *id;
+	double *fx, *fy, *fz;
+
+	int begin;
+	const ParticleStore* store;
+	// neighbour lookup over the whole store, when a force asked for one
+	const SpatialGrid* grid;
+};
+
+// Columnar storage for all the particles of a ParticleSystem.
+// Every attribute lives in its own contiguous array indexed by
+// particle number, so the simulation loops walk memory linearly
+// and a bake snapshot is a handful of flat copies.  Particles do
+// not carry their own force list; the owning ParticleSystem
+// applies its forces to the whole store.
+//
+// Particles die once their age passes their lifetime.  A dead
+// particle's slot keeps its place (so nothing shifts and indices of
+// the live ones stay put) and goes on a free list for the next
+// particle added.  Dead slots still ride along through the force and
+// integration loops (stopped, and with their force zeroed, so they
+// don't move), so once they make up a large part of the store
+// compact() moves live particles from the end into the holes.
+class ParticleStore {
 public:
-	Particle(Vec3d p, double m) : position(p), mass(m) {}
+	ParticleStore() : m_uNextId(1) {}
+
+	// slots, live or dead
+	inline int size() const { return (int)mass.size(); }
+	inline bool empty() const { return mass.empty(); }
+	inline int liveCount() const { return size() - (int)m_freeSlots.size(); }
+	inline bool alive(int i) const { return id[i] != kDeadId; }
+
+	inline void setPos(int i, const Vec3d& p) { px[i] = p[0]; py[i] = p[1]; pz[i] = p[2]; }
+	inline void setSpeed(int i, const Vec3d& s) { vx[i] = s[0]; vy[i] = s[1]; vz[i] = s[2]; }
+	inline void setNetForce(int i, const Vec3d& f) { fx[i] = f[0]; fy[i] = f[1]; fz[i] = f[2]; }
+	inline Vec3d getPos(int i) const { return Vec3d(px[i], py[i], pz[i]); }
+	inline Vec3d getSpeed(int i) const { return Vec3d(vx[i], vy[i], vz[i]); }
+	inline Vec3d getNetForce(int i) const { return Vec3d(fx[i], fy[i], fz[i]); }
+	inline double getMass(int i) const { return mass[i]; }
+
+	// adds a particle in a free slot, or at the end if there is none,
+	// and returns its index
+	int add(const Vec3d& p, const Vec3d& s, double m, float fLifetime = kImmortal);
+	void kill(int i);
+	// ages every live particle by dt and kills the ones past their
+	// lifetime; returns how many died
+	int expire(double dt);
+	// moves live particles into dead slots and drops the emptied tail
+	// if at least a quarter of the store is dead (or bForce); returns
+	// true if anything moved.  Indices of moved particles change.
+	bool compact(bool bForce = false);
+	// recomputes the free list and next id after the columns have
+	// been written directly (decoding, interpolating)
+	void rebuildFreeList();
+	void reserve(int n);
+	// grows (zero-filled, i.e. dead) or shrinks every column to n
+	// particles; follow with rebuildFreeList() unless only live
+	// particles were cut off
+	void resize(int n);
+	// no slots at all, ids starting over from 1
+	void clear();
+	// zeroes the net force of every particle before forces are applied
+	void clearForces();
+	void clearForces(int begin, int end);
+
+	// view of particles [begin, end) for batched force evaluation
+	ParticleSpan span(int begin, int end);
 
-	inline void setPos(Vec3d p) { position = p; }
-	inline void setSpeed(Vec3d s) {	speed = s; }
-	inline void setNetForce(Vec3d f) { netForce = f; }
-	inline Vec3d getPos() const { return position; }
-	inline Vec3d getSpeed() const { return speed; }
-	inline Vec3d getNetForce() const { return netForce; }
-	inline double getMass() const { return mass; }
+	// position
+	std::vector<double> px, py, pz;
+	// speed
+	std::vector<double> vx, vy, vz;
+	// net force accumulated during the current step
+	std::vector<double> fx, fy, fz;
+	std::vector<double> mass;
+	// seconds since the particle was added, and how long it lives
+	std::vector<float> age, lifetime;
+	// serial number given when the particle was added; kDeadId in a
+	// free slot.  Two frames hold the same particle in a slot only if
+	// the ids match.
+	std::vector<unsigned int> id;
 
-	void add_force(Force* f);
-	void nextPos(float deltaT);
-	void draw();
+	static const unsigned int kDeadId = 0;
+	static const float kImmortal;
 
 private:
-	double mass;
-	Vec3d position;
-	Vec3d speed;
-	Vec3d netForce;
-	std::vector<Force*> forces;
+	std::vector<int> m_freeSlots;
+	unsigned int m_uNextId;
 };
 
-#endif
\ No newline at end of file
+#endif // SAMPLE_SOLUTION
@@ -0,0 +1,771 @@
+// Stand-alone benchmarks for the particle system.
+//
+//   particlebench [-o results.json] [-max n] [-threads 1,2,4...]
+//   particlebench -barneshut [threads]
+//
+// Suite: drives whole ParticleSystems, without a window, at 1k to 10M
+// particles in four scenarios: gravity only, gravity and drag, drag
+// plus the neighbour forces (Repulsion and Cohesion), and drag plus
+// collisions with a field of shapes.  Every scenario and size is run
+// at each thread count (by default 1, 2, 4, ... up to the hardware
+// threads) and reports the time per particle per integration step,
+// the speedup over one thread and the size and cost of baking a
+// frame.  Results go to a table and to a JSON file (particlebench.json
+// by default) for comparing versions.  -max caps the particle count;
+// 10M particles take about 2 GB.
+//
+// Barnes-Hut: for 1k, 10k and 100k particles in a Plummer sphere,
+// times the tree build and the Attraction force at a few opening
+// angles against a brute force O(n^2) sum, and reports the force
+// error relative to the brute force result.  At 100k the brute force
+// time is extrapolated from a subset of the particles.
+//
+// Curves (-curves): makes random curves of every type, with wrapping
+// and adaptive sampling on and off, moves their control points about
+// and after every move checks what the curve spliced in (its pieces,
+// their table and the points it is drawn through, which must run in
+// order of x) against the same curve evaluated afresh, and reads it back at times swept
+// forwards, backwards and at random against a plain search of its
+// table.  Then it reads a CurveBank of such curves, some moved, some
+// given another point and some left alone between reads, against
+// each curve's own evaluateCurveAt().  Any difference is reported and
+// makes the exit status 1.
+
+#include "Force.h"
+#include "particle.h"
+#include "particleSystem.h"
+#include "bakeCache.h"
+#include "threadPool.h"
+#include "randomStream.h"
+#include "curve.h"
+#include "curveBank.h"
+#include "curveevaluator.h"
+#include "linearcurveevaluator.h"
+#include "Beziercurveevaluator.h"
+#include "Bsplinecurveevaluator.h"
+#include "CatmullRomcurveevaluator.h"
+#include "C2InterpolatingCurveEvaluator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.141592653589793238462643383279502
+#endif
+
+static const double kG = 1.0;
+static const double kSoftening = 0.05;
+// particles the brute force reference is evaluated for at most
+static const int kMaxReferenceCount = 2000;
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double uniform(unsigned int& state)
+{
+	// xorshift32; fixed seeds keep runs comparable
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state >> 8) * (1.0 / 16777216.0);
+}
+
+// n unit mass particles in a Plummer sphere of scale 1
+static void plummer(int n, ParticleStore& particles)
+{
+	unsigned int state = 2463534242u;
+	particles.clear();
+	particles.reserve(n);
+	for (int i = 0; i < n; ++i)
+	{
+		double u = uniform(state) * 0.999 + 0.0005;
+		double r = 1.0 / sqrt(pow(u, -2.0 / 3.0) - 1.0);
+		double cosTheta = 2.0 * uniform(state) - 1.0;
+		double sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+		double phi = 2.0 * M_PI * uniform(state);
+		particles.add(Vec3d(r * sinTheta * cos(phi), r * sinTheta * sin(phi), r * cosTheta),
+			Vec3d(0, 0, 0), 1.0);
+	}
+}
+
+// exact force on the particles of [begin, end) from all the others
+static void bruteForce(const ParticleStore& particles, int begin, int end, std::vector<double>& f)
+{
+	const int n = particles.size();
+	const double eps2 = kSoftening * kSoftening;
+	for (int i = begin; i < end; ++i)
+	{
+		double x = particles.px[i], y = particles.py[i], z = particles.pz[i];
+		double gx = 0, gy = 0, gz = 0;
+		for (int j = 0; j < n; ++j)
+		{
+			if (j == i)
+				continue;
+			double dx = particles.px[j] - x, dy = particles.py[j] - y, dz = particles.pz[j] - z;
+			double r2 = dx * dx + dy * dy + dz * dz + eps2;
+			double s = particles.mass[j] / (r2 * sqrt(r2));
+			gx += dx * s;
+			gy += dy * s;
+			gz += dz * s;
+		}
+		double s = kG * particles.mass[i];
+		f[3 * i] = gx * s;
+		f[3 * i + 1] = gy * s;
+		f[3 * i + 2] = gz * s;
+	}
+}
+
+static void benchBarnesHut(ThreadPool& pool)
+{
+	static const int kCounts[] = { 1000, 10000, 100000 };
+	static const double kThetas[] = { 0.3, 0.5, 0.7, 1.0 };
+	static const int kGrain = 1024;
+
+	printf("barnes-hut, %d threads\n", pool.threadCount());
+	printf("%8s %6s %10s %10s %12s %9s %11s %11s\n",
+		"n", "theta", "build ms", "force ms", "brute ms", "speedup", "rms err", "max err");
+
+	for (int c = 0; c < (int)(sizeof(kCounts) / sizeof(kCounts[0])); ++c)
+	{
+		int n = kCounts[c];
+		ParticleStore particles;
+		plummer(n, particles);
+
+		// the reference covers the first m particles; the sample is
+		// random, since plummer() draws every particle independently
+		int m = (n < kMaxReferenceCount) ? n : kMaxReferenceCount;
+		std::vector<double> reference(3 * n);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		pool.parallelFor(m, 16, [&](int begin, int end) { bruteForce(particles, begin, end, reference); });
+		double fBruteMs = msSince(start) * n / m;
+
+		for (int t = 0; t < (int)(sizeof(kThetas) / sizeof(kThetas[0])); ++t)
+		{
+			Attraction attraction(kG, kThetas[t], kSoftening);
+
+			start = std::chrono::steady_clock::now();
+			attraction.prepare(particles);
+			double fBuildMs = msSince(start);
+
+			particles.clearForces();
+			start = std::chrono::steady_clock::now();
+			pool.parallelFor(n, kGrain, [&](int begin, int end)
+			{
+				attraction.apply(particles.span(begin, end));
+			});
+			double fForceMs = msSince(start);
+
+			double sumErr2 = 0, maxErr = 0;
+			for (int i = 0; i < m; ++i)
+			{
+				double ex = particles.fx[i] - reference[3 * i];
+				double ey = particles.fy[i] - reference[3 * i + 1];
+				double ez = particles.fz[i] - reference[3 * i + 2];
+				double ref = sqrt(reference[3 * i] * reference[3 * i] +
+					reference[3 * i + 1] * reference[3 * i + 1] + reference[3 * i + 2] * reference[3 * i + 2]);
+				double err = sqrt(ex * ex + ey * ey + ez * ez) / ref;
+				sumErr2 += err * err;
+				if (err > maxErr)
+					maxErr = err;
+			}
+
+			printf("%8d %6.2f %10.2f %10.2f %11.1f%s %8.1fx %11.2e %11.2e\n",
+				n, kThetas[t], fBuildMs, fForceMs, fBruteMs, (m < n) ? "*" : " ",
+				fBruteMs / (fBuildMs + fForceMs), sqrt(sumErr2 / m), maxErr);
+		}
+	}
+	printf("* extrapolated from %d particles\n", kMaxReferenceCount);
+}
+
+/****
+ * ParticleSystem suite
+ ****/
+
+enum Scenario {
+	SCENARIO_GRAVITY,
+	SCENARIO_VISCOUS,
+	SCENARIO_NEIGHBOUR,
+	SCENARIO_COLLISION,
+	SCENARIO_COUNT
+};
+
+static const char* const kScenarioNames[SCENARIO_COUNT] = {
+	"gravity", "gravity+viscous", "neighbour", "collision"
+};
+
+static const float kFps = 30.0f;
+// particles per unit volume; with kNeighbourRadius each particle has
+// about eight others within Cohesion's reach
+static const double kDensity = 2000.0;
+static const double kNeighbourRadius = 0.05;
+// particle steps each run is sized to, within kMin/kMaxFrames
+static const double kParticleSteps = 4e7;
+static const int kMinFrames = 2;
+static const int kMaxFrames = 250;
+
+struct SuiteResult {
+	Scenario scenario;
+	int particles;
+	int threads;
+	int frames;
+	int steps;
+	double msPerFrame;
+	double nsPerParticleStep;
+	double speedup;					// over the one thread run, 0 if there was none
+	double bakeBytesPerFrame;
+	double bakeNsPerParticle;
+};
+
+// n particles spread evenly over a cube standing on the floor, sized
+// for kDensity
+static void fillCube(int n, ParticleStore& particles)
+{
+	unsigned int state = 88675123u;
+	double side = cbrt(n / kDensity);
+	particles.clear();
+	particles.reserve(n);
+	for (int i = 0; i < n; ++i)
+	{
+		Vec3d p(uniform(state) * side, 0.1 + uniform(state) * side, uniform(state) * side);
+		Vec3d v(uniform(state) - 0.5, uniform(state) - 0.5, uniform(state) - 0.5);
+		particles.add(p, v, 0.5 + uniform(state));
+	}
+}
+
+// a floor under the cube and a 4 x 4 grid of boxes, balls and
+// cylinders a third of the way up it
+static void addObstacles(ColliderSet& colliders, double side)
+{
+	Mat4d floor;
+	floor[0][3] = -side;
+	floor[1][3] = -0.1;
+	floor[2][3] = -side;
+	colliders.beginFrame();
+	colliders.addBox(floor, 3 * side, 0.1, 3 * side);
+
+	double cell = side / 4;
+	for (int i = 0; i < 4; ++i)
+	for (int j = 0; j < 4; ++j)
+	{
+		Mat4d at;
+		at[0][3] = (i + 0.25) * cell;
+		at[1][3] = side / 3;
+		at[2][3] = (j + 0.25) * cell;
+		switch ((i + j) % 3)
+		{
+		case 0: colliders.addBox(at, cell / 2, cell / 4, cell / 2); break;
+		case 1: colliders.addSphere(at, cell / 4); break;
+		case 2: colliders.addCylinder(at, cell / 2, cell / 4, cell / 8); break;
+		}
+	}
+	colliders.endFrame();
+}
+
+static ParticleSystem* createScenario(Scenario scenario, int n, int iThreads)
+{
+	ParticleSystem* ps = new ParticleSystem(9.8, (scenario == SCENARIO_GRAVITY) ? 0.0 : 0.1);
+	if (scenario == SCENARIO_NEIGHBOUR)
+	{
+		ps->addForce(new Repulsion(kNeighbourRadius, 50.0));
+		ps->addForce(new Cohesion(2 * kNeighbourRadius, 5.0));
+	}
+	if (scenario == SCENARIO_COLLISION)
+		addObstacles(ps->getColliders(), cbrt(n / kDensity));
+
+	ps->setThreadCount(iThreads);
+	ps->setBakeFps(kFps);
+	fillCube(n, ps->getParticles());
+	return ps;
+}
+
+// Times one scenario at one size and thread count.  Updates land
+// half way between frames, off the frame grid, so nothing is baked
+// and only the simulation is timed.
+static SuiteResult runScenario(Scenario scenario, int n, int iThreads)
+{
+	SuiteResult result;
+	result.scenario = scenario;
+	result.particles = n;
+	result.speedup = 0;
+
+	ParticleSystem* ps = createScenario(scenario, n, iThreads);
+	result.threads = ps->getThreadCount();
+
+	int iFrames = (int)(kParticleSteps / ((double)n * ps->getSubsteps()));
+	if (iFrames < kMinFrames)
+		iFrames = kMinFrames;
+	if (iFrames > kMaxFrames)
+		iFrames = kMaxFrames;
+
+	// one frame first, so the timed ones find their buffers grown
+	ps->startSimulation(0.5f / kFps);
+	ps->computeForcesAndUpdateParticles(1.5f / kFps);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int f = 2; f < iFrames + 2; ++f)
+		ps->computeForcesAndUpdateParticles((f + 0.5f) / kFps);
+	double fMs = msSince(start);
+	ps->stopSimulation(0);
+
+	result.frames = iFrames;
+	result.steps = iFrames * ps->getSubsteps();
+	result.msPerFrame = fMs / iFrames;
+	result.nsPerParticleStep = fMs * 1e6 / ((double)n * result.steps);
+
+	// baking is single threaded; the best of a few stores of the
+	// final state
+	BakeCache bake(kFps);
+	double fBestMs = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		bake.clear();
+		start = std::chrono::steady_clock::now();
+		bake.store(0, ps->getParticles());
+		double fStoreMs = msSince(start);
+		if (i == 0 || fStoreMs < fBestMs)
+			fBestMs = fStoreMs;
+	}
+	result.bakeBytesPerFrame = (double)bake.memoryUsage();
+	result.bakeNsPerParticle = fBestMs * 1e6 / n;
+
+	delete ps;
+	return result;
+}
+
+static bool writeJson(const char* szFileName, const std::vector<SuiteResult>& results)
+{
+	FILE* fp = fopen(szFileName, "w");
+	if (!fp)
+		return false;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"benchmark\": \"particle-system\",\n");
+	fprintf(fp, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(fp, "  \"fps\": %g,\n", kFps);
+	fprintf(fp, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const SuiteResult& r = results[i];
+		fprintf(fp, "    { \"scenario\": \"%s\", \"particles\": %d, \"threads\": %d, "
+			"\"frames\": %d, \"steps\": %d, \"ms_per_frame\": %.4f, "
+			"\"ns_per_particle_step\": %.4f, \"speedup\": %.3f, "
+			"\"bake_bytes_per_frame\": %.0f, \"bake_ns_per_particle\": %.4f }%s\n",
+			kScenarioNames[r.scenario], r.particles, r.threads, r.frames, r.steps, r.msPerFrame,
+			r.nsPerParticleStep, r.speedup, r.bakeBytesPerFrame, r.bakeNsPerParticle,
+			(i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(fp, "  ]\n");
+	fprintf(fp, "}\n");
+	return fclose(fp) == 0;
+}
+
+static void benchSuite(const char* szJsonFile, int iMaxParticles, const std::vector<int>& threadCounts)
+{
+	static const int kCounts[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+	printf("particle system at %g fps\n", kFps);
+	printf("%-16s %9s %7s %7s %11s %10s %8s %11s %10s\n",
+		"scenario", "n", "threads", "frames", "ms/frame", "ns/p/step", "speedup", "bake B/fr", "bake ns/p");
+
+	std::vector<SuiteResult> results;
+	for (int s = 0; s < SCENARIO_COUNT; ++s)
+	{
+		for (int c = 0; c < (int)(sizeof(kCounts) / sizeof(kCounts[0])); ++c)
+		{
+			if (kCounts[c] > iMaxParticles)
+				break;
+
+			double fOneThreadMs = 0;
+			for (size_t t = 0; t < threadCounts.size(); ++t)
+			{
+				SuiteResult r = runScenario((Scenario)s, kCounts[c], threadCounts[t]);
+				if (r.threads == 1)
+					fOneThreadMs = r.msPerFrame;
+				if (fOneThreadMs > 0)
+					r.speedup = fOneThreadMs / r.msPerFrame;
+				results.push_back(r);
+
+				printf("%-16s %9d %7d %7d %11.3f %10.2f %7.2fx %11.0f %10.2f\n",
+					kScenarioNames[r.scenario], r.particles, r.threads, r.frames, r.msPerFrame,
+					r.nsPerParticleStep, r.speedup, r.bakeBytesPerFrame, r.bakeNsPerParticle);
+				fflush(stdout);
+			}
+		}
+	}
+
+	if (writeJson(szJsonFile, results))
+		printf("results written to %s\n", szJsonFile);
+	else
+		fprintf(stderr, "particlebench: can't write %s\n", szJsonFile);
+}
+
+static const int kCurvePoints = 40;
+static const int kCurveMoves = 300;
+static const float kCurveLength = 20.0f;
+static const int kBankCurves = 10;
+static const int kBankRounds = 300;
+
+static const char* const kCurveNames[CURVE_TYPE_COUNT] = {
+	"linear", "b-spline", "bezier", "catmull-rom", "c2"
+};
+
+static const CurveEvaluator* curveEvaluator(int iType)
+{
+	static const LinearCurveEvaluator linear;
+	static const BsplineCurveEvaluator bspline;
+	static const BezierCurveEvaluator bezier;
+	static const CatmullRomCurveEvaluator catmullRom;
+	static const C2InterpolatingCurveEvaluator c2;
+	static const CurveEvaluator* const evaluators[CURVE_TYPE_COUNT] = {
+		&linear, &bspline, &bezier, &catmullRom, &c2
+	};
+	return evaluators[iType];
+}
+
+// A curve whose evaluated pieces and drawn points can be compared
+// with another's
+class CheckedCurve : public Curve
+{
+public:
+	CheckedCurve(int iType, bool bWrap, bool bAdaptive, const std::vector<Point>& points) :
+		Curve(kCurveLength, points.front())
+	{
+		for (size_t i = 1; i < points.size(); ++i)
+			addControlPoint(points[i]);
+		setEvaluator(curveEvaluator(iType));
+		wrap(bWrap);
+		adaptive(bAdaptive);
+	}
+
+	const std::vector<CurveSegment>& pieces() const
+	{
+		updatePieces();
+		return m_pieces;
+	}
+	const std::vector<Point>& points() const
+	{
+		reevaluate();
+		return m_ptvEvaluatedCurvePts;
+	}
+	std::vector<Point> controlPoints() const { return m_ptvCtrlPts; }
+};
+
+static bool sameSegment(const CurveSegment& a, const CurveSegment& b)
+{
+	if (a.x0 != b.x0 || a.x1 != b.x1)
+		return false;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (a.x[i] != b.x[i] || a.y[i] != b.y[i])
+			return false;
+	}
+	return true;
+}
+
+static bool sameSegments(const std::vector<CurveSegment>& a, const std::vector<CurveSegment>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (!sameSegment(a[i], b[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool samePoints(const std::vector<Point>& a, const std::vector<Point>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (a[i].x != b[i].x || a[i].y != b[i].y)
+			return false;
+		if (i > 0 && a[i].x < a[i - 1].x)
+			return false;
+	}
+	return true;
+}
+
+static bool sameTable(const CurveSegmentTable& a, const CurveSegmentTable& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); ++i)
+	{
+		if (!sameSegment(a.segment(i), b.segment(i)))
+			return false;
+	}
+	return true;
+}
+
+// the value at x found by looking through the whole table
+static float scannedValueAt(const CurveSegmentTable& table, float x)
+{
+	if (table.empty())
+		return 0.0f;
+	const CurveSegment& first = table.segment(0);
+	const CurveSegment& last = table.segment(table.size() - 1);
+	if (x <= first.x0)
+		return (float)first.valueAt(first.x0);
+	if (x >= last.x1)
+		return (float)last.valueAt(last.x1);
+
+	int i = 0;
+	while (table.segment(i).x1 < x)
+		++i;
+	return (float)table.segment(i).valueAt(x);
+}
+
+// Reads the curve the way playback does (from where the last lookup
+// was, or searching when it jumped) against a plain search: forwards
+// a frame at a time, backwards, then at random, past both ends too
+static bool sameLookups(const Curve& curve, RandomStream& random)
+{
+	const CurveSegmentTable& table = curve.segments();
+	std::vector<float> times;
+	for (float t = -1.0f; t <= kCurveLength + 1.0f; t += 1.0f / 30)
+		times.push_back(t);
+	for (float t = kCurveLength + 1.0f; t >= -1.0f; t -= 1.0f / 24)
+		times.push_back(t);
+	for (int i = 0; i < 200; ++i)
+		times.push_back((float)random.uniform(-1, kCurveLength + 1));
+	// the ends of the entries exactly, and either side of them
+	for (int i = 0; i < table.size(); i += 3)
+	{
+		float x = table.segment(i).x1;
+		times.push_back(x);
+		times.push_back(nextafterf(x, -1e30f));
+		times.push_back(nextafterf(x, 1e30f));
+	}
+
+	for (size_t i = 0; i < times.size(); ++i)
+	{
+		if (curve.evaluateCurveAt(times[i]) != scannedValueAt(table, times[i]))
+			return false;
+	}
+	return true;
+}
+
+// moves one control point, or a run of them, somewhere random in the
+// animation, as dragging them in the graph would
+static void moveRandomly(Curve& curve, RandomStream& random)
+{
+	const int n = curve.controlPointCount();
+	const int iPoint = random.below(n);
+	if (random.below(3) == 0)
+	{
+		std::vector<int> points;
+		for (int i = iPoint; i < n && i < iPoint + 1 + random.below(4); ++i)
+			points.push_back(i);
+		curve.moveControlPoints(points,
+			Point((float)random.uniform(-0.3, 0.3), (float)random.uniform(-2, 2)), -10.0f, 10.0f);
+	}
+	else
+	{
+		Point pt;
+		curve.getControlPoint(iPoint, pt);
+		float x = std::min(std::max(pt.x + (float)random.uniform(-0.3, 0.3), 0.0f), kCurveLength);
+		curve.moveControlPoint(iPoint, Point(x, (float)random.uniform(-10, 10)));
+	}
+}
+
+static bool checkCurves()
+{
+	printf("%-12s %5s %9s %6s %9s\n", "curve", "wrap", "adaptive", "moves", "failures");
+
+	int iFailures = 0;
+	for (int iType = 0; iType < CURVE_TYPE_COUNT; ++iType)
+	{
+		for (int iCase = 0; iCase < 4; ++iCase)
+		{
+			const bool bWrap = (iCase & 1) != 0;
+			const bool bAdaptive = (iCase & 2) != 0;
+			RandomStream random(1, iType, iCase);
+
+			std::vector<Point> points;
+			for (int i = 0; i < kCurvePoints; ++i)
+			{
+				points.push_back(Point((i + (float)random.uniform(0.1, 0.9)) * kCurveLength / kCurvePoints,
+					(float)random.uniform(-10, 10)));
+			}
+			CheckedCurve curve(iType, bWrap, bAdaptive, points);
+			curve.segments();
+
+			int iCaseFailures = 0;
+			for (int iMove = 0; iMove < kCurveMoves; ++iMove)
+			{
+				moveRandomly(curve, random);
+				// the points and the table catch up in either order
+				if (iMove % 2)
+					curve.points();
+
+				// everything the move changed against the curve made
+				// from scratch out of the same control points
+				CheckedCurve fresh(iType, bWrap, bAdaptive, curve.controlPoints());
+				bool bSame = sameSegments(curve.pieces(), fresh.pieces()) &&
+					sameTable(curve.segments(), fresh.segments()) &&
+					samePoints(curve.points(), fresh.points()) &&
+					sameLookups(curve, random);
+				if (!bSame)
+					++iCaseFailures;
+			}
+
+			printf("%-12s %5s %9s %6d %9d\n", kCurveNames[iType], bWrap ? "on" : "off",
+				bAdaptive ? "on" : "off", kCurveMoves, iCaseFailures);
+			iFailures += iCaseFailures;
+		}
+	}
+
+	if (iFailures > 0)
+		printf("%d moves left the curves different from evaluating them afresh\n", iFailures);
+	return iFailures == 0;
+}
+
+// Between reads a few of the bank's curves move (as many pieces as
+// before, copied over the old ones) and now and then one gets another
+// point (more pieces, so the bank is packed anew)
+static bool checkCurveBank()
+{
+	RandomStream random(2, 0, 0);
+	std::vector<CheckedCurve*> curves;
+	CurveBank bank;
+	for (int c = 0; c < kBankCurves; ++c)
+	{
+		std::vector<Point> points;
+		int n = 2 + random.below(kCurvePoints);
+		for (int i = 0; i < n; ++i)
+		{
+			points.push_back(Point((i + (float)random.uniform(0.1, 0.9)) * kCurveLength / n,
+				(float)random.uniform(-10, 10)));
+		}
+		curves.push_back(new CheckedCurve(c % CURVE_TYPE_COUNT, random.below(2) == 0,
+			random.below(2) == 0, points));
+		bank.add(curves.back());
+	}
+
+	int iFailures = 0;
+	float t = 0.0f;
+	for (int iRound = 0; iRound < kBankRounds; ++iRound)
+	{
+		int iChanges = random.below(4);
+		for (int i = 0; i < iChanges; ++i)
+		{
+			Curve& curve = *curves[random.below(kBankCurves)];
+			if (random.below(8) == 0)
+				curve.addControlPoint(Point((float)random.uniform(0, kCurveLength), (float)random.uniform(-10, 10)));
+			else
+				moveRandomly(curve, random);
+		}
+
+		// mostly played forwards, sometimes scrubbed to anywhere
+		t = (random.below(10) == 0) ? (float)random.uniform(-1, kCurveLength + 1) : t + 1.0f / 30;
+		if (t > kCurveLength + 1)
+			t = -1.0f;
+
+		bool bSame = true;
+		bank.evaluate(t);
+		for (int c = 0; c < kBankCurves; ++c)
+		{
+			if (bank.values()[c] != curves[c]->evaluateCurveAt(t))
+				bSame = false;
+		}
+		// read one at a time, after the curve changes or at another time
+		for (int c = 0; c < kBankCurves; ++c)
+		{
+			float tRead = (random.below(2) == 0) ? t : (float)random.uniform(-1, kCurveLength + 1);
+			if (bank.value(c, tRead) != curves[c]->evaluateCurveAt(tRead))
+				bSame = false;
+		}
+		if (!bSame)
+			++iFailures;
+	}
+
+	printf("%-12s %5s %9s %6d %9d\n", "bank", "mixed", "mixed", kBankRounds, iFailures);
+	if (iFailures > 0)
+		printf("%d reads of the bank differed from its curves\n", iFailures);
+
+	for (int c = 0; c < kBankCurves; ++c)
+		delete curves[c];
+	return iFailures == 0;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+		"usage: particlebench [-o results.json] [-max n] [-threads 1,2,4...]\n"
+		"       particlebench -barneshut [threads]\n"
+		"       particlebench -curves\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "-barneshut"))
+	{
+		int iThreads = (argc > 2) ? atoi(argv[2]) : 0;
+		ThreadPool pool(iThreads);
+
+		benchBarnesHut(pool);
+		return 0;
+	}
+	if (argc > 1 && !strcmp(argv[1], "-curves"))
+	{
+		bool bCurves = checkCurves();
+		bool bBank = checkCurveBank();
+		return (bCurves && bBank) ? 0 : 1;
+	}
+
+	const char* szJsonFile = "particlebench.json";
+	int iMaxParticles = 10000000;
+	std::vector<int> threadCounts;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool bHasValue = (i + 1 < argc);
+		if (!strcmp(argv[i], "-o") && bHasValue)
+			szJsonFile = argv[++i];
+		else if (!strcmp(argv[i], "-max") && bHasValue)
+			iMaxParticles = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-threads") && bHasValue)
+		{
+			// a comma separated list
+			for (const char* sz = argv[++i]; *sz; )
+			{
+				int n = atoi(sz);
+				if (n > 0)
+					threadCounts.push_back(n);
+				while (*sz && *sz != ',')
+					++sz;
+				if (*sz)
+					++sz;
+			}
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (threadCounts.empty())
+	{
+		int iHardware = (int)std::thread::hardware_concurrency();
+		if (iHardware < 1)
+			iHardware = 1;
+		for (int n = 1; n < iHardware; n *= 2)
+			threadCounts.push_back(n);
+		threadCounts.push_back(iHardware);
+	}
+
+	benchSuite(szJsonFile, iMaxParticles, threadCounts);
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include "particleKernels.h"
+#include "particle.h"
+
+#include <atomic>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLE_KERNELS_X86
+#endif
+
+#ifdef PARTICLE_KERNELS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// MSVC lets any function use AVX intrinsics; gcc/clang need the
+// target attribute so the rest of the file stays baseline code.
+#if defined(PARTICLE_KERNELS_X86) && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// a level forced by setSimdLevel(), or -1; kernels read it from the
+// worker threads
+static std::atomic<int> s_iForcedSimdLevel(-1);
+
+/** One axis of the Euler update; used directly and for vector tails */
+static void eulerAxisScalar(double* p, double* v, const double* f, const double* m, int n, double dt)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		v[i] += f[i] / m[i] * dt;
+		p[i] += v[i] * dt;
+	}
+}
+
+#ifdef PARTICLE_KERNELS_X86
+
+static void eulerAxisSSE2(double* p, double* v, const double* f, const double* m, int n, double dt)
+{
+	const __m128d vdt = _mm_set1_pd(dt);
+	int i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d acc = _mm_mul_pd(_mm_div_pd(_mm_loadu_pd(f + i), _mm_loadu_pd(m + i)), vdt);
+		__m128d speed = _mm_add_pd(_mm_loadu_pd(v + i), acc);
+		_mm_storeu_pd(v + i, speed);
+		_mm_storeu_pd(p + i, _mm_add_pd(_mm_loadu_pd(p + i), _mm_mul_pd(speed, vdt)));
+	}
+	eulerAxisScalar(p + i, v + i, f + i, m + i, n - i, dt);
+}
+
+TARGET_AVX2 static void eulerAxisAVX2(double* p, double* v, const double* f, const double* m, int n, double dt)
+{
+	const __m256d vdt = _mm256_set1_pd(dt);
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d acc = _mm256_mul_pd(_mm256_div_pd(_mm256_loadu_pd(f + i), _mm256_loadu_pd(m + i)), vdt);
+		__m256d speed = _mm256_add_pd(_mm256_loadu_pd(v + i), acc);
+		_mm256_storeu_pd(v + i, speed);
+		_mm256_storeu_pd(p + i, _mm256_add_pd(_mm256_loadu_pd(p + i), _mm256_mul_pd(speed, vdt)));
+	}
+	// avoid the AVX/SSE transition penalty before returning to SSE code
+	_mm256_zeroupper();
+	eulerAxisScalar(p + i, v + i, f + i, m + i, n - i, dt);
+}
+
+#endif // PARTICLE_KERNELS_X86
+
+SimdLevel detectSimdLevel()
+{
+#ifdef PARTICLE_KERNELS_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int iMaxLeaf = info[0];
+	__cpuid(info, 1);
+	bool bSSE2 = (info[3] & (1 << 26)) != 0;
+	bool bOSXSave = (info[2] & (1 << 27)) != 0;
+	bool bAVX = (info[2] & (1 << 28)) != 0;
+	bool bAVX2 = false;
+	if (iMaxLeaf >= 7 && bOSXSave && bAVX)
+	{
+		// the OS must also save the ymm registers on context switches
+		if ((_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			bAVX2 = (info[1] & (1 << 5)) != 0;
+		}
+	}
+#else
+	__builtin_cpu_init();
+	bool bSSE2 = __builtin_cpu_supports("sse2") != 0;
+	bool bAVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+	if (bAVX2)
+		return SIMD_AVX2;
+	if (bSSE2)
+		return SIMD_SSE2;
+#endif // PARTICLE_KERNELS_X86
+	return SIMD_SCALAR;
+}
+
+SimdLevel getSimdLevel()
+{
+	// detected once, by whichever thread gets here first; the others
+	// wait for it
+	static const SimdLevel detected = detectSimdLevel();
+
+	int iForced = s_iForcedSimdLevel.load(std::memory_order_relaxed);
+	return (iForced < 0) ? detected : (SimdLevel)iForced;
+}
+
+void setSimdLevel(SimdLevel level)
+{
+	SimdLevel best = detectSimdLevel();
+	s_iForcedSimdLevel.store((level > best) ? best : level, std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+void eulerStep(ParticleStore& particles, int begin, int end, double dt)
+{
+	int n = end - begin;
+	if (n <= 0)
+		return;
+
+	double* p[3] = { &particles.px[begin], &particles.py[begin], &particles.pz[begin] };
+	double* v[3] = { &particles.vx[begin], &particles.vy[begin], &particles.vz[begin] };
+	const double* f[3] = { &particles.fx[begin], &particles.fy[begin], &particles.fz[begin] };
+	const double* m = &particles.mass[begin];
+
+	void (*axis)(double*, double*, const double*, const double*, int, double) = eulerAxisScalar;
+#ifdef PARTICLE_KERNELS_X86
+	switch (getSimdLevel()) {
+	case SIMD_AVX2:
+		axis = eulerAxisAVX2;
+		break;
+	case SIMD_SSE2:
+		axis = eulerAxisSSE2;
+		break;
+	default:
+		break;
+	}
+#endif
+
+	for (int k = 0; k < 3; ++k)
+	{
+		axis(p[k], v[k], f[k], m, n, dt);
+	}
+}
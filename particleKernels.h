@@ -0,0 +1,28 @@
+#ifndef PARTICLE_KERNELS_H
+#define PARTICLE_KERNELS_H
+
+class ParticleStore;
+
+// Instruction sets the particle kernels can run on.  The best level
+// the cpu (and OS) supports is picked the first time a kernel runs.
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_SSE2, SIMD_AVX2 };
+
+SimdLevel detectSimdLevel();
+SimdLevel getSimdLevel();
+// Forces a lower level (e.g. to compare paths); requests above what
+// detectSimdLevel() reports are clamped to it.
+void setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// Explicit Euler step for particles [begin, end):
+//   speed += netForce / mass * dt;  position += speed * dt;
+// Every path performs the same IEEE operations in the same order
+// (divide, multiply, add; no fused multiply-add), so SSE2 and AVX2
+// results are bit-identical to the scalar loop whenever the scalar
+// code is compiled to SSE2 as well.  With x87 scalar code generation
+// (32-bit builds without /arch:SSE2) the scalar loop keeps extended
+// precision intermediates and the paths may differ by a few ulp,
+// i.e. a relative error below 1e-12 per step.
+void eulerStep(ParticleStore& particles, int begin, int end, double dt);
+
+#endif // PARTICLE_KERNELS_H
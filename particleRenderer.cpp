@@ -0,0 +1,268 @@
+#include "particleRenderer.h"
+#include "particle.h"
+#include <FL/gl.h>
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+
+// point sprites are core in GL 2.0; Windows' gl.h stops at 1.1
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
+#ifndef GL_COORD_REPLACE
+#define GL_COORD_REPLACE 0x8862
+#endif
+
+// so are buffer objects in GL 1.5, and their entry points have to be
+// looked up at run time
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (APIENTRY *BufferSubDataProc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+
+static GenBuffersProc s_glGenBuffers;
+static DeleteBuffersProc s_glDeleteBuffers;
+static BindBufferProc s_glBindBuffer;
+static BufferDataProc s_glBufferData;
+static BufferSubDataProc s_glBufferSubData;
+
+static void* glProc(const char* szName)
+{
+#ifdef _WIN32
+	return (void*)wglGetProcAddress(szName);
+#else
+	return (void*)glXGetProcAddressARB((const GLubyte*)szName);
+#endif
+}
+
+// side of the sprite texture, in texels
+static const int kSpriteSize = 32;
+// vertex buffers grow to this many times what a frame needs, so a
+// growing cloud doesn't reallocate every frame
+static const double kBufferSlack = 1.5;
+
+ParticleRenderer::ParticleRenderer() :
+	m_fPointSize(5),
+	m_bSprites(false),
+	m_bFade(false),
+	m_iSpriteSupport(-1),
+	m_uSpriteTexture(0),
+	m_iBufferSupport(-1),
+	m_uBuffer(0),
+	m_uBufferSize(0)
+{
+	setColor(0, 0, 1);
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+	// nothing was made unless draw() ran, in the model's GL context
+	if (m_uSpriteTexture)
+		glDeleteTextures(1, &m_uSpriteTexture);
+	if (m_uBuffer)
+		s_glDeleteBuffers(1, &m_uBuffer);
+}
+
+// Copies the live particles into the vertex (and colour) arrays and
+// returns how many there are
+int ParticleRenderer::pack(const ParticleStore& particles)
+{
+	int n = particles.size();
+	m_vertices.resize(3 * n);
+	if (m_bFade)
+		m_colors.resize(4 * n);
+
+	unsigned char r = (unsigned char)(m_color[0] * 255 + 0.5f);
+	unsigned char g = (unsigned char)(m_color[1] * 255 + 0.5f);
+	unsigned char b = (unsigned char)(m_color[2] * 255 + 0.5f);
+
+	int iLive = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		if (!particles.alive(i))
+			continue;
+
+		float* v = &m_vertices[3 * iLive];
+		v[0] = (float)particles.px[i];
+		v[1] = (float)particles.py[i];
+		v[2] = (float)particles.pz[i];
+
+		if (m_bFade)
+		{
+			float fLeft = 1.0f;
+			if (particles.lifetime[i] != ParticleStore::kImmortal && particles.lifetime[i] > 0)
+				fLeft = 1.0f - particles.age[i] / particles.lifetime[i];
+			if (fLeft < 0) fLeft = 0;
+			if (fLeft > 1) fLeft = 1;
+			unsigned char* c = &m_colors[4 * iLive];
+			c[0] = r; c[1] = g; c[2] = b;
+			c[3] = (unsigned char)(fLeft * 255 + 0.5f);
+		}
+		++iLive;
+	}
+	return iLive;
+}
+
+bool ParticleRenderer::spritesSupported()
+{
+	if (m_iSpriteSupport < 0)
+	{
+		const char* szVersion = (const char*)glGetString(GL_VERSION);
+		const char* szExtensions = (const char*)glGetString(GL_EXTENSIONS);
+		m_iSpriteSupport = (szVersion && atoi(szVersion) >= 2) ||
+			(szExtensions && strstr(szExtensions, "GL_ARB_point_sprite")) ? 1 : 0;
+
+		if (m_iSpriteSupport)
+		{
+			// white, with alpha falling off smoothly to the rim
+			std::vector<unsigned char> texels(4 * kSpriteSize * kSpriteSize);
+			for (int y = 0; y < kSpriteSize; ++y)
+			for (int x = 0; x < kSpriteSize; ++x)
+			{
+				double dx = (x + 0.5) / kSpriteSize * 2 - 1;
+				double dy = (y + 0.5) / kSpriteSize * 2 - 1;
+				double d = sqrt(dx * dx + dy * dy);
+				double a = (d < 1) ? 1 - d * d : 0;
+				unsigned char* t = &texels[4 * (y * kSpriteSize + x)];
+				t[0] = t[1] = t[2] = 255;
+				t[3] = (unsigned char)(a * 255 + 0.5);
+			}
+			glGenTextures(1, &m_uSpriteTexture);
+			glBindTexture(GL_TEXTURE_2D, m_uSpriteTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kSpriteSize, kSpriteSize, 0,
+						 GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+	return m_iSpriteSupport == 1;
+}
+
+bool ParticleRenderer::buffersSupported()
+{
+	if (m_iBufferSupport < 0)
+	{
+		m_iBufferSupport = 0;
+
+		const char* szVersion = (const char*)glGetString(GL_VERSION);
+		const char* szExtensions = (const char*)glGetString(GL_EXTENSIONS);
+		int iMajor = szVersion ? atoi(szVersion) : 0;
+		const char* szMinor = szVersion ? strchr(szVersion, '.') : NULL;
+		int iMinor = szMinor ? atoi(szMinor + 1) : 0;
+		const char* szSuffix = NULL;
+		if (iMajor > 1 || (iMajor == 1 && iMinor >= 5))
+			szSuffix = "";
+		else if (szExtensions && strstr(szExtensions, "GL_ARB_vertex_buffer_object"))
+			szSuffix = "ARB";
+
+		if (szSuffix)
+		{
+			std::string strSuffix(szSuffix);
+			s_glGenBuffers = (GenBuffersProc)glProc(("glGenBuffers" + strSuffix).c_str());
+			s_glDeleteBuffers = (DeleteBuffersProc)glProc(("glDeleteBuffers" + strSuffix).c_str());
+			s_glBindBuffer = (BindBufferProc)glProc(("glBindBuffer" + strSuffix).c_str());
+			s_glBufferData = (BufferDataProc)glProc(("glBufferData" + strSuffix).c_str());
+			s_glBufferSubData = (BufferSubDataProc)glProc(("glBufferSubData" + strSuffix).c_str());
+			if (s_glGenBuffers && s_glDeleteBuffers && s_glBindBuffer && s_glBufferData && s_glBufferSubData)
+			{
+				s_glGenBuffers(1, &m_uBuffer);
+				m_iBufferSupport = 1;
+			}
+		}
+	}
+	return m_iBufferSupport == 1;
+}
+
+size_t ParticleRenderer::upload(int n)
+{
+	size_t uVertexBytes = 3 * n * sizeof(float);
+	size_t uColorBytes = m_bFade ? 4 * n : 0;
+	size_t uBytes = uVertexBytes + uColorBytes;
+
+	s_glBindBuffer(GL_ARRAY_BUFFER, m_uBuffer);
+	if (uBytes > m_uBufferSize)
+	{
+		m_uBufferSize = (size_t)(uBytes * kBufferSlack);
+		s_glBufferData(GL_ARRAY_BUFFER, m_uBufferSize, NULL, GL_STREAM_DRAW);
+	}
+	s_glBufferSubData(GL_ARRAY_BUFFER, 0, uVertexBytes, &m_vertices[0]);
+	if (uColorBytes)
+		s_glBufferSubData(GL_ARRAY_BUFFER, uVertexBytes, uColorBytes, &m_colors[0]);
+	return uVertexBytes;
+}
+
+void ParticleRenderer::draw(const ParticleStore& particles)
+{
+	int n = pack(particles);
+	if (n == 0)
+		return;
+
+	bool bSprites = m_bSprites && spritesSupported();
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_POINT_BIT | GL_COLOR_BUFFER_BIT |
+				 GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_LIGHTING_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+	// lit as setDiffuseColor() would light them, with the colour (per
+	// particle when fading) standing in for the diffuse material
+	glColorMaterial(GL_FRONT_AND_BACK, GL_DIFFUSE);
+	glEnable(GL_COLOR_MATERIAL);
+	glPointSize(m_fPointSize);
+
+	const char* pVertices = (const char*)&m_vertices[0];
+	const char* pColors = m_bFade ? (const char*)&m_colors[0] : NULL;
+	if (buffersSupported())
+	{
+		// offsets into the buffer from here on
+		pVertices = NULL;
+		pColors = pVertices + upload(n);
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, pVertices);
+	if (m_bFade)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, pColors);
+	}
+	else
+		glColor3f(m_color[0], m_color[1], m_color[2]);
+
+	if (m_bFade || bSprites)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// translucent points are drawn unsorted; keep them from hiding
+		// the ones behind
+		glDepthMask(GL_FALSE);
+	}
+
+	if (bSprites)
+	{
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, m_uSpriteTexture);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		glEnable(GL_POINT_SPRITE);
+		glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
+	}
+
+	glDrawArrays(GL_POINTS, 0, n);
+
+	if (m_iBufferSupport == 1)
+		s_glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glPopClientAttrib();
+	glPopAttrib();
+}
@@ -0,0 +1,68 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include <vector>
+#include <cstddef>
+
+class ParticleStore;
+
+// Draws all the live particles of a store as points in a single
+// glDrawArrays call.  Positions (as floats) and, when fading, colours
+// are packed into arrays every frame and streamed into a vertex
+// buffer object, so drawing costs a pass over memory and one upload
+// rather than a handful of GL calls per particle.  Drivers without
+// GL 1.5 or ARB_vertex_buffer_object draw from the arrays directly.
+//
+// Points are lit like the rest of the model, with the colour as
+// their diffuse material.
+//
+// With point sprites on (and supported by the driver) each point is
+// a soft round disc rather than a square.
+class ParticleRenderer {
+public:
+	ParticleRenderer();
+	// both virtual and out of line, so that code holding a renderer
+	// doesn't have to link GL
+	virtual ~ParticleRenderer();
+
+	virtual void draw(const ParticleStore& particles);
+
+	void setColor(float r, float g, float b) { m_color[0] = r; m_color[1] = g; m_color[2] = b; }
+	// size of a point, in pixels
+	void setPointSize(float fSize) { if (fSize > 0) m_fPointSize = fSize; }
+	float getPointSize() const { return m_fPointSize; }
+	void setPointSprites(bool b) { m_bSprites = b; }
+	bool getPointSprites() const { return m_bSprites; }
+	// Particles with a lifetime become more transparent as they age.
+	// Off by default: fading draws blended, without depth writes.
+	void setFadeWithAge(bool b) { m_bFade = b; }
+	bool getFadeWithAge() const { return m_bFade; }
+
+private:
+	ParticleRenderer(const ParticleRenderer&);
+	ParticleRenderer& operator=(const ParticleRenderer&);
+
+	int pack(const ParticleStore& particles);
+	bool spritesSupported();
+	bool buffersSupported();
+	// uploads the packed arrays into the buffer and returns the
+	// offset of the colours in it
+	size_t upload(int n);
+
+	float m_color[3];
+	float m_fPointSize;
+	bool m_bSprites;
+	bool m_bFade;
+
+	// -1 until the driver has been asked
+	int m_iSpriteSupport;
+	unsigned int m_uSpriteTexture;
+	int m_iBufferSupport;
+	unsigned int m_uBuffer;
+	size_t m_uBufferSize;					// bytes allocated to m_uBuffer
+
+	std::vector<float> m_vertices;			// x, y, z per live particle
+	std::vector<unsigned char> m_colors;	// r, g, b, a per live particle
+};
+
+#endif // PARTICLE_RENDERER_H
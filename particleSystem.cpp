@@ -1,27 +1,66 @@
 #pragma warning(disable : 4786)
 
 #include "particleSystem.h"
+#include "frameTimings.h"
 
-#include <ctime>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
 #include <vector>
-#include <FL/gl.h>
-#include "modelerdraw.h"
+#include <atomic>
 
 
+// particles per work chunk handed to the thread pool
+static const int kSimulationGrain = 4096;
+
+// integration steps per displayed frame
+static const int kDefaultSubsteps = 4;
+// most simulated time a single update may advance, in seconds
+static const float kDefaultMaxStep = 0.25f;
+// leftover time this close to a whole step (in steps) still takes it,
+// so frame times that are exact multiples of the step don't drift
+static const double kStepEpsilon = 1e-4;
+
+static const unsigned int kDefaultSeed = 1;
+
+// bounce off the scene's shapes
+static const double kDefaultRestitution = 0.5;
+static const double kDefaultFriction = 0.3;
+
 /***************
  * Constructors
  ***************/
 
-ParticleSystem::ParticleSystem(double gravity_a, double viscous_k) 
+ParticleSystem::ParticleSystem(double gravity_a, double viscous_k) :
+	currentT(0),
+	accumulator(0),
+	substeps(kDefaultSubsteps),
+	max_step(kDefaultMaxStep),
+	integrator_type(INTEGRATOR_SYMPLECTIC_EULER),
+	integrator(createIntegrator(INTEGRATOR_SYMPLECTIC_EULER)),
+	seed(kDefaultSeed),
+	step_index(0),
+	live_frame(-1),
+	live_behind(false),
+	draws_colliders(false),
+	renderer(NULL),
+	restitution(kDefaultRestitution),
+	friction(kDefaultFriction),
+	look_ahead(0),
+	bake_stop(false),
+	playhead(0),
+	shown_valid(false),
+	bake_start_time(0),
+	bake_end_time(-1),
+	simulate(false),
+	dirty(false)
 {
-	srand(time(0));
 	forces.push_back(new Gravity(Vec3d(0, -gravity_a, 0)));
-	forces.push_back(new Viscous(viscous_k));
+	// no drag at all rather than a pass computing none
+	if (viscous_k != 0)
+		forces.push_back(new Viscous(viscous_k));
 
 }
 
@@ -35,9 +74,20 @@ ParticleSystem::ParticleSystem(double gravity_a, double viscous_k)
 
 ParticleSystem::~ParticleSystem() 
 {
-	// TODO
+	stopBakeThread();
 	particles.clear();
+	for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
+	{
+		delete *it;
+	}
 	forces.clear();
+	for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); it++)
+	{
+		delete *it;
+	}
+	emitters.clear();
+	delete integrator;
+	delete renderer;
 
 }
 
@@ -50,25 +100,60 @@ ParticleSystem::~ParticleSystem()
 void ParticleSystem::startSimulation(float t)
 {
     
-	// TODO
-
 	// These values are used by the UI ...
 	// -ve bake_end_time indicates that simulation
 	// is still progressing, and allows the
 	// indicator window above the time slider
 	// to correctly show the "baked" region
 	// in grey.
-	bake_end_time = -1;
+	stopBakeThread();
+
+	// resume from t rather than from wherever the
+	// playhead was the last time we simulated
+	currentT = t;
+	accumulator = 0;
+	// whatever set the particles up since didn't tell the integrator
+	integrator->invalidate();
+	int iFrame = bakeCache.frameAt(t);
+	bool bBaked;
+	{
+		std::lock_guard<std::mutex> lock(bake_mutex);
+		bBaked = bakeCache.hasFrame(iFrame);
+		if (bakeCache.empty())
+			bake_start_time = t;
+		bake_end_time = -1;
+	}
+	// with nothing baked at t the particles as they are start off
+	// frame t; otherwise they carry on past the baked frames, if
+	// they hold the last of them, emitters and all
+	if (!bBaked)
+	{
+		step_index = (unsigned int)(iFrame * substeps);
+		live_frame = iFrame;
+		for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); it++)
+		{
+			(*it)->reset();
+		}
+	}
+	live_behind = bBaked;
+
 	simulate = true;
 	dirty = true;
 
+	if (look_ahead > 0 && canBakeAhead())
+		startBakeThread(t);
+
 }
 
 /** Stop the simulation */
 void ParticleSystem::stopSimulation(float t)
 {
     
-	// TODO
+	stopBakeThread();
+
+	int iLast = bakeCache.lastFrame();
+	if (iLast >= 0)
+		bake_end_time = bakeCache.timeOf(iLast);
 
 	// These values are used by the UI
 	simulate = false;
@@ -80,7 +165,28 @@ void ParticleSystem::stopSimulation(float t)
 void ParticleSystem::resetSimulation(float t)
 {
     
-	// TODO
+	stopBakeThread();
+
+	// no particles, as when the system was made; the next start
+	// begins afresh at its own time.  Baked frames are left for
+	// clearBaked().
+	particles.clear();
+	integrator->invalidate();
+	currentT = t;
+	accumulator = 0;
+	step_index = 0;
+	live_frame = -1;
+	live_behind = false;
+	for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); it++)
+	{
+		(*it)->reset();
+	}
+	{
+		std::lock_guard<std::mutex> lock(bake_mutex);
+		shown_valid = false;
+		int iLast = bakeCache.lastFrame();
+		bake_end_time = (iLast >= 0) ? bakeCache.timeOf(iLast) : -1;
+	}
 
 	// These values are used by the UI
 	simulate = false;
@@ -92,43 +198,311 @@ void ParticleSystem::resetSimulation(float t)
 void ParticleSystem::computeForcesAndUpdateParticles(float t)
 {
 
-	// TODO
-	bake_fps = t - currentT;
+	double elapsed = t - currentT;
 	currentT = t;
+
+	if (bake_thread.joinable())
+	{
+		// the bake thread does the simulating; all that's left here is
+		// to tell it how far along playback is and show the frame at t
+		// once it's been baked
+		{
+			std::lock_guard<std::mutex> lock(bake_mutex);
+			playhead = t;
+			shown_valid = bakeCache.sample(t, shown);
+		}
+		bake_wake.notify_one();
+		return;
+	}
+
+	// anything inside the baked range is played back, never
+	// simulated.  Baked frames come back quantized or interpolated,
+	// so they're only decoded for display: the particles keep the
+	// exact state they were simulated to, to carry on from.
+	bool bBaked;
+	{
+		std::lock_guard<std::mutex> lock(bake_mutex);
+		bBaked = bakeCache.sample(t, shown);
+		shown_valid = bBaked;
+	}
+	if (bBaked)
+	{
+		live_behind = true;
+		return;
+	}
+
 	if (isSimulate())
 	{
-		if (!isBakedAt(t))
+		if (live_behind)
 		{
-			for (std::vector<Particle>::iterator it = particles.begin(); it != particles.end(); it++)
+			// past the baked frames, carry on from the last one before
+			// t, but only if the particles hold it exactly; otherwise
+			// there's nothing to simulate from until the next baked
+			// frames or a reset
+			int iFrom = (int)ceil(t * bakeCache.fps() - BakeCache::kFrameEpsilon) - 1;
+			bool bFromBaked;
+			{
+				std::lock_guard<std::mutex> lock(bake_mutex);
+				bFromBaked = bakeCache.hasFrame(iFrom);
+			}
+			if (bFromBaked)
 			{
-				it->nextPos(bake_fps);
+				if (live_frame != iFrom)
+					return;
+				elapsed = t - bakeCache.timeOf(iFrom);
+				accumulator = 0;
 			}
-			bakeParticles(t);
-			printf("not baked\n");
+			live_behind = false;
 		}
-		else 
+
+		// the integration step is fixed; however long it's been since
+		// the last redraw only decides how many steps are taken.
+		// Scrubbing backwards takes none, and a stall takes at most
+		// max_step worth of them.
+		if (elapsed < 0)
+			elapsed = 0;
+		if (elapsed > max_step)
+			elapsed = max_step;
+		accumulator += elapsed;
+
+		double h = getStepSize();
+		int n = (int)floor(accumulator / h + kStepEpsilon);
+		accumulator -= n * h;
+		if (accumulator < 0)
+			accumulator = 0;
+
+		advance(t, n, shapesAt(t, posed_colliders));
+		bakeParticles(t);
+	}
+}
+
+/** Take n steps, ending at time t */
+void ParticleSystem::advance(float t, int n, const ColliderSet& shapes)
+{
+	if (n <= 0)
+		return;
+	ScopedTiming timing(TIMING_SIMULATE);
+
+	for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); it++)
+	{
+		(*it)->drive(t);
+	}
+
+	double h = getStepSize();
+	for (int i = 0; i < n; ++i)
+	{
+		emitParticles(h, (double)i / n, (double)(i + 1) / n);
+		step(h, shapes);
+	}
+
+	// dead slots are recycled by the next spawns; compacting
+	// only happens once they're a big part of every pass
+	int iDied = particles.expire(n * h);
+	bool bMoved = particles.compact();
+	if (iDied > 0 || bMoved)
+		integrator->invalidate();
+}
+
+/** Advance every particle by one step of length h */
+void ParticleSystem::step(double h, const ColliderSet& shapes)
+{
+	bool bSpeedDependent = false;
+	for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
+	{
+		bSpeedDependent = bSpeedDependent || (*it)->speedDependent();
+	}
+	integrator->setSpeedDependent(bSpeedDependent);
+	integrator->step(particles, h, [this](ParticleStore& store) { evaluateForces(store); }, pool);
+	collide(h, shapes);
+}
+
+/** Particles the emitters add over a step, covering the fraction
+  * [from, to] of the emitters' motion this frame */
+void ParticleSystem::emitParticles(double h, double from, double to)
+{
+	for (size_t i = 0; i < emitters.size(); ++i)
+	{
+		// one stream per emitter and step, so what a step emits doesn't
+		// depend on the steps before it
+		RandomStream random(seed, (unsigned int)i, step_index);
+		if (emitters[i]->emit(particles, h, from, to, random) > 0)
+			integrator->invalidate();
+	}
+	++step_index;
+}
+
+/** Push particles that went into the scene's shapes back out */
+void ParticleSystem::collide(double h, const ColliderSet& shapes)
+{
+	if (shapes.empty())
+		return;
+
+	// shapes are only read, and each particle is handled on its own
+	std::atomic<int> contacts(0);
+	pool.parallelFor(particles.size(), kSimulationGrain, [this, h, &shapes, &contacts](int begin, int end)
+	{
+		int n = shapes.collide(particles, begin, end, h, restitution, friction);
+		if (n > 0)
+			contacts += n;
+	});
+	if (contacts > 0)
+		integrator->invalidate();
+}
+
+/** The shapes to collide with when simulating up to time t: posed
+  * into posed for t if there's a poser, otherwise as last drawn */
+const ColliderSet& ParticleSystem::shapesAt(float t, ColliderSet& posed)
+{
+	if (!collider_poser)
+		return colliders;
+
+	posed.beginFrame();
+	collider_poser(posed, t);
+	posed.endFrame();
+	return posed;
+}
+
+/** Whether frames can be simulated ahead of the playhead: the drawn
+  * shapes are only right for the time on screen, so a scene that has
+  * any needs them posed for the frame being simulated */
+bool ParticleSystem::canBakeAhead()
+{
+	return collider_poser || (!draws_colliders && colliders.empty());
+}
+
+/** Bake from t on, on a thread of its own.  False if the frames
+  * baked from t on can't be carried on from: baked frames are only
+  * approximations, so the thread starts from the particles' exact
+  * state, which has to be one of them. */
+bool ParticleSystem::startBakeThread(float t)
+{
+	int iFrame;
+	{
+		std::lock_guard<std::mutex> lock(bake_mutex);
+		iFrame = bakeCache.frameAt(t);
+		if (bakeCache.hasFrame(iFrame))
 		{
-			particles = bakeInfo[t];
-			printf("baked\n");
+			// simulated on through the rest of the frames already
+			// baked from t on, which are kept
+			int iLast = iFrame;
+			while (bakeCache.hasFrame(iLast + 1))
+				++iLast;
+			if (live_frame < iFrame || live_frame > iLast)
+				return false;
+			iFrame = live_frame;
 		}
+		playhead = t;
+		bake_stop = false;
 	}
+	shown_valid = false;
+	step_index = (unsigned int)(iFrame * substeps);
+	live_frame = iFrame;
+	bake_thread = std::thread(&ParticleSystem::bakeLoop, this, iFrame);
+	return true;
 }
 
-
-/** Render particles */
-void ParticleSystem::drawParticles(float t)
+void ParticleSystem::stopBakeThread()
 {
+	if (!bake_thread.joinable())
+		return;
 
-	// TODO
-	if (isSimulate())
 	{
-		for (std::vector<Particle>:: iterator it = particles.begin(); it != particles.end(); it++)
+		std::lock_guard<std::mutex> lock(bake_mutex);
+		bake_stop = true;
+	}
+	bake_wake.notify_one();
+	bake_thread.join();
+}
+
+/** Body of the bake thread: bakes the particles' current state as
+  * frame iFrame, then simulates and bakes one frame after another,
+  * waiting whenever it is look_ahead ahead of the playhead.  Frames
+  * baked by an earlier run are kept, and simulated through rather
+  * than continued from. */
+void ParticleSystem::bakeLoop(int iFrame)
+{
+	ColliderSet shapes;
+	for (;; ++iFrame)
+	{
 		{
-			it->draw();
+			std::unique_lock<std::mutex> lock(bake_mutex);
+			if (!bakeCache.hasFrame(iFrame))
+				bakeCache.store(iFrame, particles);
+			live_frame = iFrame;
+			if (bakeCache.timeOf(iFrame) > bake_end_time)
+				bake_end_time = bakeCache.timeOf(iFrame);
+
+			float fNext = bakeCache.timeOf(iFrame + 1);
+			bake_wake.wait(lock, [this, fNext]() { return bake_stop || fNext <= playhead + look_ahead; });
+			if (bake_stop)
+				return;
 		}
+
+		float fNext = bakeCache.timeOf(iFrame + 1);
+		advance(fNext, substeps, shapesAt(fNext, shapes));
 	}
 }
 
+/** Net force on every particle of the store in its current state */
+void ParticleSystem::evaluateForces(ParticleStore& store)
+{
+	// forces between particles find their neighbours in a grid
+	// sorted from this very state, or build their own structures
+	double radius = 0.0;
+	for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
+	{
+		(*it)->prepare(store);
+		if ((*it)->neighbourRadius() > radius)
+			radius = (*it)->neighbourRadius();
+	}
+	const SpatialGrid* pGrid = NULL;
+	if (radius > 0.0)
+	{
+		grid.build(store, radius, pool);
+		pGrid = &grid;
+	}
+
+	// every particle only writes its own slots, so chunks can
+	// run on any thread in any order
+	bool bDead = store.liveCount() < store.size();
+	pool.parallelFor(store.size(), kSimulationGrain, [this, &store, pGrid, bDead](int begin, int end)
+	{
+		store.clearForces(begin, end);
+		ParticleSpan span = store.span(begin, end);
+		span.grid = pGrid;
+		for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
+		{
+			(*it)->apply(span);
+		}
+		// dead slots ride along through the integrators' loops; with
+		// no speed (kill() stops them) and no force they stay put
+		if (bDead)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				if (!store.alive(i))
+					store.setNetForce(i, Vec3d(0, 0, 0));
+			}
+		}
+	});
+}
+
+
+/** Render particles */
+void ParticleSystem::drawParticles(float t)
+{
+
+	if (!renderer)
+		return;
+
+	// baked frames are drawn as decoded; the particles themselves
+	// only while they're being simulated at the playhead
+	if (shown_valid)
+		renderer->draw(shown);
+	else if (!bake_thread.joinable() && isSimulate() && !live_behind)
+		renderer->draw(particles);
+}
+
 
 
 
@@ -138,52 +512,156 @@ void ParticleSystem::drawParticles(float t)
 void ParticleSystem::bakeParticles(float t) 
 {
 
-	// TODO
-	bakeInfo.insert(std::pair<float, std::vector<Particle>>(t, particles));
+	// states between two frames are interpolated on playback,
+	// so only states on the frame grid are kept
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	if (bakeCache.onFrame(t))
+	{
+		live_frame = bakeCache.frameAt(t);
+		bakeCache.store(live_frame, particles);
+	}
+	else
+		live_frame = -1;
 }
 
 /** Clears out your data structure of baked particles */
 void ParticleSystem::clearBaked()
 {
 
-	// TODO
-	bakeInfo.clear();
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	bakeCache.clear();
+	shown_valid = false;
+	// a running bake thread carries on from where it is
+	if (bake_thread.joinable() && bake_end_time >= 0)
+		bake_start_time = bake_end_time;
+}
+
+bool ParticleSystem::saveBakeCache(const char* szFileName)
+{
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	return bakeCache.save(szFileName);
+}
+
+bool ParticleSystem::loadBakeCache(const char* szFileName)
+{
+	// frames baked from here on would belong to another simulation
+	if (bake_thread.joinable())
+	{
+		stopBakeThread();
+		simulate = false;
+		dirty = true;
+	}
+
+	if (!bakeCache.open(szFileName))
+		return false;
+	// the particles hold none of the loaded frames
+	live_frame = -1;
+
+	int iFirst = bakeCache.firstFrame();
+	int iLast = bakeCache.lastFrame();
+	bake_start_time = (iFirst >= 0) ? bakeCache.timeOf(iFirst) : 0;
+	bake_end_time = (iLast >= 0) ? bakeCache.timeOf(iLast) : -1;
+	dirty = true;
+	return true;
 }
 
 bool ParticleSystem:: isBakedAt(float t)
 {
-	map<float, std::vector<Particle>>::iterator it = bakeInfo.find(t);
-	return (it!=bakeInfo.end());
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	return bakeCache.covers(t);
 }
 
-void ParticleSystem:: SpawnParticles(Vec3d pos, int num)
+float ParticleSystem::getBakeEndTime()
 {
-	if (isSimulate())
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	return bake_end_time;
+}
+
+void ParticleSystem::setBakeFps(float fps)
+{
+	std::lock_guard<std::mutex> lock(bake_mutex);
+	if (fps != bakeCache.fps())
 	{
-		if (!isBakedAt(currentT + bake_fps))
-		{
-			for (int i = 0; i < num; ++i)
-			{
-				double mass = rand()%5 + 0.2;
-				Particle p = Particle(pos, mass);
-				double F = rand() % 10 / 10.0 + 0.2;
-				double theta = rand() % 360 / 57.3;
-
-				double zSpeed = -(rand() % 10 / 10.0 + 5);
-				// double ySpeed = cos(theta) * F;
-				// double xSpeed = sin(theta) * F;
-				double ySpeed = 0;
-				double xSpeed = -(rand() % 10 / 10.0 ) + 0.5;
-				p.setSpeed(Vec3d(xSpeed, ySpeed, zSpeed));
-				for (std::vector<Force*>::iterator it = forces.begin(); it != forces.end(); it++)
-				{
-					p.add_force(*it);
-				}
-				particles.push_back(p);
+		// frames baked at another rate can't be indexed any more
+		bakeCache.fps(fps);
+		live_frame = -1;
+		bake_start_time = currentT;
+	}
+}
 
-			}
-		}
+void ParticleSystem::setIntegrator(IntegratorType type)
+{
+	if (type == integrator_type)
+		return;
+	delete integrator;
+	integrator = createIntegrator(type);
+	integrator_type = type;
+}
+
+void ParticleSystem::addForce(Force* force)
+{
+	forces.push_back(force);
+}
+
+void ParticleSystem::setThreadCount(int n)
+{
+	// the bake thread may be inside pool.parallelFor; let it finish
+	// its step, rebuild the pool, and carry on from where it stopped
+	bool bRunning = bake_thread.joinable();
+	stopBakeThread();
+	pool.threadCount(n);
+	if (bRunning && !startBakeThread(playhead))
+	{
+		simulate = false;
+		dirty = true;
 	}
 }
 
+void ParticleSystem::setRestitution(double e)
+{
+	if (e >= 0 && e <= 1)
+		restitution = e;
+}
+
+void ParticleSystem::setFriction(double mu)
+{
+	if (mu >= 0)
+		friction = mu;
+}
+
+void ParticleSystem::setRenderer(ParticleRenderer* r)
+{
+	if (r != renderer)
+		delete renderer;
+	renderer = r;
+}
+
+void ParticleSystem::addEmitter(Emitter* emitter)
+{
+	emitters.push_back(emitter);
+}
+
+void ParticleSystem::setLookAhead(float seconds)
+{
+	if (seconds >= 0)
+		look_ahead = seconds;
+}
+
+void ParticleSystem::setSubsteps(int n)
+{
+	if (n >= 1)
+		substeps = n;
+}
+
+void ParticleSystem::setMaxStep(float t)
+{
+	if (t > 0)
+		max_step = t;
+}
+
+double ParticleSystem::getStepSize()
+{
+	return 1.0 / (bakeCache.fps() * substeps);
+}
+
 
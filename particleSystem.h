@@ -19,8 +19,21 @@
 #include "vec.h"
 #include <vector>
 #include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include "Force.h"
-#include "Particle.h"
+#include "particle.h"
+#include "threadPool.h"
+#include "bakeCache.h"
+#include "integrator.h"
+#include "spatialGrid.h"
+#include "collider.h"
+#include "particleRenderer.h"
+#include "randomStream.h"
+#include "emitter.h"
+#include "controlCurves.h"
 
 class ParticleSystem {
 
@@ -64,16 +77,112 @@ public:
 	// of baked particles (without leaking memory).
 	virtual void clearBaked();	
 
+	// Writes the baked frames to a .pcache file, or replaces them with
+	// the frames of one.  Loaded frames are memory mapped and paged in
+	// as they are played back.
+	bool saveBakeCache(const char* szFileName);
+	bool loadBakeCache(const char* szFileName);
+
+	// True if t is a baked frame or falls between two baked frames
 	virtual bool isBakedAt(float t);
 
-	void SpawnParticles(Vec3d pos, int num);
+	// Frame rate the bake cache is indexed at (the UI's playback fps).
+	// Changing it discards frames baked at the old rate.
+	void setBakeFps(float fps);
+
+	// Adds a force applied to every particle; the system owns it from
+	// now on.  Forces between particles (Repulsion, Cohesion) get a
+	// neighbour grid rebuilt before every force evaluation; Attraction
+	// rebuilds its own octree.
+	void addForce(Force* force);
+
+	// Adds an emitter, owned by the system from now on.  Emitters are
+	// driven once a frame and emit at the start of every step.
+	void addEmitter(Emitter* emitter);
+
+	// The controls drivers should read, rather than the UI: they may
+	// be driven on the bake thread, ahead of the playhead.  The
+	// modeler copies its curves in here whenever simulation starts.
+	ControlCurves& getControls() { return controls; }
+
+	// With a look-ahead, simulation runs on a thread of its own that
+	// bakes frames up to that many seconds past the last time drawn,
+	// and drawing only ever shows finished frames, so a slow frame no
+	// longer stalls the UI.  0 (the default) simulates on the calling
+	// thread as every frame is drawn.  Takes effect from the next
+	// startSimulation().  Frames ahead of the playhead need the
+	// colliders posed for their own time, so a scene with colliders
+	// but no collider poser is always simulated as if it were 0.
+	void setLookAhead(float seconds);
+	float getLookAhead() { return look_ahead; }
+
+	// Everything random about the particles comes from streams seeded
+	// by this, the emitter and the step, so simulating the same frames
+	// with the same seed bakes the same particles, bit for bit.
+	void setSeed(unsigned int s) { seed = s; }
+	unsigned int getSeed() { return seed; }
+
+	// The simulation advances in fixed steps of 1 / (bake fps * substeps)
+	// seconds, however irregularly it is redrawn.  No single update
+	// simulates more than the max step; time lost to longer stalls is
+	// dropped rather than caught up in one unstable leap.
+	void setSubsteps(int n);
+	int getSubsteps() { return substeps; }
+	void setMaxStep(float t);
+	float getMaxStep() { return max_step; }
+	double getStepSize();
+
+	// Scheme each step is integrated with.  RK4 costs four force
+	// passes a step but tolerates far fewer substeps.
+	void setIntegrator(IntegratorType type);
+	IntegratorType getIntegrator() { return integrator_type; }
+
+	// Solid shapes the particles bounce off, re-recorded by the model
+	// every time it is drawn.  Restitution is the share of the speed
+	// into a surface a particle bounces back with; friction is the
+	// Coulomb coefficient slowing it along the surface.
+	ColliderSet& getColliders() { return colliders; }
+	// Set by scenes whose model records shapes into getColliders()
+	// as it draws: simulating such a scene without drawing it (as the
+	// command line baker does) misses them
+	void setDrawsColliders(bool b) { draws_colliders = b; }
+	bool getDrawsColliders() { return draws_colliders; }
+	// Adds the scene's shapes as they stand at time t, read off
+	// getControls() rather than the UI.  With one, the system poses
+	// the shapes for every time it simulates (on the bake thread too)
+	// and the drawn ones are ignored.
+	typedef std::function<void(ColliderSet&, float)> ColliderPoser;
+	void setColliderPoser(const ColliderPoser& poser) { collider_poser = poser; }
+	bool hasColliderPoser() { return collider_poser != nullptr; }
+	void setRestitution(double e);
+	double getRestitution() { return restitution; }
+	void setFriction(double mu);
+	double getFriction() { return friction; }
+
+	// What drawParticles draws with, owned by the system from now on;
+	// without one (say, when baking from the command line) nothing
+	// is drawn and nothing needs GL
+	void setRenderer(ParticleRenderer* r);
+	ParticleRenderer* getRenderer() { return renderer; }
+
+	// particles alive right now
+	int getParticleCount() const { return particles.liveCount(); }
+	// The particles themselves, for tools that set up a state of
+	// their own (never while a bake thread runs)
+	ParticleStore& getParticles() { return particles; }
+
+	// Number of threads the simulation step is spread across
+	// (0 = one per core).  Results are identical for any count.  A
+	// running bake thread is paused while the pool is rebuilt.
+	void setThreadCount(int n);
+	int getThreadCount() const { return pool.threadCount(); }
 
 
 
 	// These accessor fxns are implemented for you
 	float getBakeStartTime() { return bake_start_time; }
-	float getBakeEndTime() { return bake_end_time; }
-	float getBakeFps() { return bake_fps; }
+	float getBakeEndTime();
+	float getBakeFps() { return bakeCache.fps(); }
 	bool isSimulate() { return simulate; }
 	bool isDirty() { return dirty; }
 	void setDirty(bool d) { dirty = d; }
@@ -83,12 +192,41 @@ public:
 protected:
 	
 	float currentT;
-	vector<Particle> particles;
-	vector<Force*> forces;
-	map<float, vector<Particle>> bakeInfo;
+	double accumulator;					// simulated time owed, less than one step
+	int substeps;						// integration steps per frame
+	float max_step;						// most time one update may simulate
+	IntegratorType integrator_type;
+	Integrator* integrator;				// owned
+	unsigned int seed;
+	unsigned int step_index;			// steps since frame 0, for seeding
+	ParticleStore particles;			// only ever simulated, never decoded from a bake
+	int live_frame;						// frame particles hold exactly, -1 if none
+	bool live_behind;					// baked frames were shown since particles were simulated
+	vector<Force*> forces;				// owned by the system, applied to every particle
+	vector<Emitter*> emitters;			// owned
+	SpatialGrid grid;					// neighbour lookup for forces between particles
+	ColliderSet colliders;				// as recorded by the last draw
+	bool draws_colliders;				// the model records colliders when drawn
+	ColliderPoser collider_poser;		// may be empty
+	ColliderSet posed_colliders;		// the poser's, for the calling thread
+	ParticleRenderer* renderer;			// owned, may be NULL
+	double restitution;
+	double friction;
+	BakeCache bakeCache;
+	ThreadPool pool;
+	ControlCurves controls;
+
+	/** Background baking **/
+	float look_ahead;
+	std::thread bake_thread;			// running while simulating with a look-ahead
+	std::mutex bake_mutex;				// guards bakeCache, bake_end_time and the fields below
+	std::condition_variable bake_wake;
+	bool bake_stop;
+	float playhead;						// time last drawn
+	ParticleStore shown;				// baked frame on screen, decoded
+	bool shown_valid;
 
 	/** Some baking-related state **/
-	float bake_fps;						// frame rate at which simulation was baked
 	float bake_start_time;				// time at which baking started 
 										// These 2 variables are used by the UI for
 										// updating the grey indicator 
@@ -98,6 +236,17 @@ protected:
 	bool simulate;						// flag for simulation mode
 	bool dirty;							// flag for updating ui (don't worry about this)
 
+	void advance(float t, int n, const ColliderSet& shapes);
+	void step(double h, const ColliderSet& shapes);
+	void emitParticles(double h, double from, double to);
+	void collide(double h, const ColliderSet& shapes);
+	const ColliderSet& shapesAt(float t, ColliderSet& posed);
+	bool canBakeAhead();
+	bool startBakeThread(float t);
+	void stopBakeThread();
+	void bakeLoop(int iFrame);
+	void evaluateForces(ParticleStore& store);
+
 };
 
 
@@ -0,0 +1,62 @@
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+// A xoshiro128** generator: small, fast on 32-bit builds and good
+// enough for anything visual.  Unlike rand() it has no global state,
+// so every emitter (or thread) owns its streams, and a stream is
+// named by (seed, stream, counter) rather than by how many numbers
+// were drawn before it.  Reseeding with the same three values always
+// replays the same numbers, which is what makes a bake repeatable:
+// emitters reseed from (system seed, emitter, frame).
+class RandomStream {
+public:
+	RandomStream(unsigned int seed = 0, unsigned int stream = 0, unsigned int counter = 0)
+	{
+		reseed(seed, stream, counter);
+	}
+
+	void reseed(unsigned int seed, unsigned int stream, unsigned int counter)
+	{
+		// splitmix64 scatters nearby keys over the whole state
+		unsigned long long x = ((unsigned long long)seed << 32) | stream;
+		x ^= (unsigned long long)counter * 0xD1B54A32D192ED03ull;
+		for (int i = 0; i < 4; i += 2)
+		{
+			unsigned long long z = (x += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			z ^= z >> 31;
+			m_s[i] = (unsigned int)z;
+			m_s[i + 1] = (unsigned int)(z >> 32);
+		}
+		if ((m_s[0] | m_s[1] | m_s[2] | m_s[3]) == 0)
+			m_s[0] = 1;
+	}
+
+	// 32 random bits
+	inline unsigned int next()
+	{
+		unsigned int result = rotl(m_s[1] * 5, 7) * 9;
+		unsigned int t = m_s[1] << 9;
+		m_s[2] ^= m_s[0];
+		m_s[3] ^= m_s[1];
+		m_s[1] ^= m_s[2];
+		m_s[0] ^= m_s[3];
+		m_s[2] ^= t;
+		m_s[3] = rotl(m_s[3], 11);
+		return result;
+	}
+
+	// in [0, 1)
+	inline double uniform() { return next() * (1.0 / 4294967296.0); }
+	inline double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+	// in [0, n), for n > 0
+	inline int below(int n) { return (int)(((unsigned long long)next() * (unsigned int)n) >> 32); }
+
+private:
+	static inline unsigned int rotl(unsigned int x, int k) { return (x << k) | (x >> (32 - k)); }
+
+	unsigned int m_s[4];
+};
+
+#endif // RANDOM_STREAM_H
@@ -11,6 +11,7 @@
 #include "mat.h"
 #include "modelerglobals.h"
 #include "ParticleSystem.h">
+#include "robotParticles.h"
 #include <math.h>
 // To make a SampleModel, we inherit off of ModelerView
 class SampleModel : public ModelerView 
@@ -114,13 +115,6 @@ public:
     	  0, 0, 0, 1);
     }
     virtual void draw();
-    void drawParticles(Mat4d CameraMatrix, int num)
-	{
-	    Mat4d WorldMatrix = CameraMatrix.inverse() * getModelViewMatrix();
-	    Vec4d pos = WorldMatrix * Vec4d(0.5, 1, -2, 1);
-	    ParticleSystem *ps = ModelerApplication::Instance()->GetParticleSystem();
-	    ps->SpawnParticles(Vec3d(pos[0], pos[1], pos[2]), num);
-	}
 
     int arm_angle = 0;
 	int arm_angle_step = 1;
@@ -299,8 +293,6 @@ void SampleModel::draw()
 		glTranslated(-1, 0.6, -1);
 
 		drawHead(VAL(ROTATE_HEAD_DEC), VAL(LEVEL_OF_DETAILS));
-		//Particle System
-		drawParticles(CameraMatrix, VAL(PARTICLE_NUM));
 
 		glPopMatrix();
 
@@ -606,8 +598,6 @@ void SampleModel::draw()
 			glTranslated(-1, 0.6, -1);
 
 			drawHead(VAL(ROTATE_HEAD_DEC), VAL(LEVEL_OF_DETAILS));
-			//Particle System
-			drawParticles(CameraMatrix, VAL(PARTICLE_NUM));
 
 			glPopMatrix();
 
@@ -1020,7 +1010,12 @@ int main()
 	// You should create a ParticleSystem object ps here and then
 	// call ModelerApplication::Instance()->SetParticleSystem(ps)
 	// to hook it up to the animator interface.
-	ParticleSystem *ps = new ParticleSystem(5, 0.1);
+	ParticleSystem *ps = createRobotParticleSystem();
+	ps->setRenderer(new ParticleRenderer());
+	// Bake up to two seconds ahead of the playhead, off the UI thread;
+	// the robot's colliders are posed from the controls for each frame
+	// the bake thread simulates.
+	ps->setLookAhead(2.0f);
 	ModelerApplication::Instance()->SetParticleSystem(ps);
 
     ModelerApplication::Instance()->Init(&createSampleModel, controls, NUMCONTROLS);
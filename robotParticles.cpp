@@ -0,0 +1,221 @@
+#include "robotParticles.h"
+#include "particleSystem.h"
+#include "modelercontrols.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.141592653589793238462643383279502
+#endif
+
+static Mat4d translation(double x, double y, double z)
+{
+	return Mat4d(1, 0, 0, x,
+				 0, 1, 0, y,
+				 0, 0, 1, z,
+				 0, 0, 0, 1);
+}
+
+// like glRotated, about a unit axis
+static Mat4d rotation(double degrees, double x, double y, double z)
+{
+	double a = degrees * M_PI / 180.0;
+	double c = cos(a), s = sin(a);
+	return Mat4d(x*x*(1-c)+c, x*y*(1-c)-z*s, x*z*(1-c)+y*s, 0,
+				 y*x*(1-c)+z*s, y*y*(1-c)+c, y*z*(1-c)-x*s, 0,
+				 x*z*(1-c)-y*s, y*z*(1-c)+x*s, z*z*(1-c)+c, 0,
+				 0, 0, 0, 1);
+}
+
+static Mat4d scaling(double x, double y, double z)
+{
+	return Mat4d(x, 0, 0, 0,
+				 0, y, 0, 0,
+				 0, 0, z, 0,
+				 0, 0, 0, 1);
+}
+
+// Control iControl at time t as SampleModel::draw sees it: the mood
+// cycle holds the head and arms in a pose of its own
+static double pose(const ControlCurves& controls, int iControl, float t)
+{
+	if (controls.value(MOOD_CYCLE, t))
+	{
+		switch (iControl)
+		{
+		case ROTATE_HEAD_X:			return 30;
+		case ROTATE_RIGHT_ARM_X:
+		case ROTATE_LEFT_ARM_X:		return 90;
+		case ROTATE_RIGHT_ARM_Y:
+		case ROTATE_LEFT_ARM_Y:		return -40;
+		case ROTATE_RIGHT_ARM_L_X:
+		case ROTATE_LEFT_ARM_L_X:	return 120;
+		}
+	}
+	return controls.value(iControl, t);
+}
+
+// The robot's frame, then the head's, as SampleModel::draw sets them
+// up, but computed from the controls without a round trip through GL
+static Mat4d robotTransform(const ControlCurves& controls, float t)
+{
+	return translation(controls.value(XPOS, t), controls.value(YPOS, t), controls.value(ZPOS, t));
+}
+
+static Mat4d headTransform(const ControlCurves& controls, float t)
+{
+	return robotTransform(controls, t)
+		* translation(-1, 15, -1)
+		* translation(1, -0.6, 1)
+		* rotation(pose(controls, ROTATE_HEAD_X, t), 1, 0, 0)
+		* rotation(pose(controls, ROTATE_HEAD_Y, t), 0, 1, 0)
+		* rotation(pose(controls, ROTATE_HEAD_Z, t), 0, 0, 1)
+		* translation(-1, 0.6, -1);
+}
+
+// The pose functions below add the boxes, cylinders and spheres the
+// matching parts of SampleModel::draw draw, in the same order and
+// with m standing in for the modelview.  Pyramids, prisms, the torus
+// and the dodecahedra aren't solid.
+
+// drawHead: the head and the neck
+static void poseHead(ColliderSet& shapes, const Mat4d& m, int level)
+{
+	Mat4d head = m * scaling(2, 2, 2);
+	if (level > 0)
+		shapes.addBox(head, 1, 1, 1);
+	if (level > 1)
+		shapes.addBox(head * translation(0.5, 0, 0.5) * translation(-0.2, -0.3, -0.2), 0.4, 0.4, 0.4);
+}
+
+// An arm; the left one is the right one turned about y with its
+// angles negated, which is what side (1 or -1) does
+static void poseArm(ColliderSet& shapes, Mat4d m, double side, double x, double y, double z,
+					double lowerX, double lowerY, double lowerZ, double lift, int level, bool bIndividual)
+{
+	m = m * translation(2.5, 12.5, -1)
+		* translation(0, 1, 1)
+		* rotation(side * (-x + lift), 1, 0, 0)
+		* rotation(side * y, 0, 1, 0)
+		* rotation(side * z, 0, 0, 1)
+		* translation(0, -1, -1);
+	// drawShoulder
+	if (!bIndividual && level > 0)
+		shapes.addBox(m, 2, 2, 2);
+
+	m = m * translation(0, 0, 0.25) * translation(0, -3, 0);
+	if (level > 1)
+		shapes.addBox(m, 1.5, 3, 1.5);
+	m = m * translation(0, -0.5, 0.5) * translation(0, 0, 0.25);
+	if (level > 1)
+		shapes.addCylinder(m * rotation(90, 0, 1, 0), 1.5, 0.5, 0.5);
+
+	m = m * translation(0, 0, -0.25)
+		* translation(0.5, 0, 0.25)
+		* rotation(side * (-lowerX - 3 * lift), 1, 0, 0)
+		* rotation(side * lowerY, 0, 1, 0)
+		* rotation(side * lowerZ, 0, 0, 1)
+		* translation(-0.5, 0, -0.25)
+		* translation(0, -3.5, -0.5);
+	if (level > 2)
+		shapes.addBox(m, 1.5, 3, 1.5);
+}
+
+// A leg down to the knee, mirrored like the arms; the lower leg and
+// foot are prisms
+static void poseLeg(ColliderSet& shapes, Mat4d m, double side, double x, double y, double z,
+					double lift, int level)
+{
+	m = m * translation(0, 5, 0)
+		* rotation(side * (-x - lift), 1, 0, 0)
+		* rotation(side * y, 0, 1, 0)
+		* rotation(side * z, 0, 0, 1)
+		* translation(0, -5, 0)
+		* translation(0.5, 1.5, -1)
+		* scaling(0.75, 1, 1);
+	if (level > 0)
+		shapes.addBox(m, 2, 4.5, 2);
+	m = m * translation(0, -0.5, 1);
+	if (level > 1)
+		shapes.addCylinder(m * rotation(90, 0, 1, 0), 2, 0.5, 0.5);
+}
+
+// drawLSystem: a sphere at every fork
+static void poseLSystem(ColliderSet& shapes, const Mat4d& m, int depth)
+{
+	if (depth < 1)
+		return;
+	Mat4d fork = m * translation(0, 2, 0);
+	shapes.addSphere(fork, 0.1);
+	if (depth == 1)
+		return;
+	poseLSystem(shapes, fork * rotation(-60 / depth, 0, 0, 1), depth - 1);
+	poseLSystem(shapes, fork * rotation(60 / depth, 0, 0, 1), depth - 1);
+}
+
+// Everything SampleModel::draw draws solid at time t, but the IK
+// chain, whose joints are solved incrementally from draw to draw and
+// so can't be posed for an arbitrary time.  The mirrored robot isn't
+// solid either.
+static void poseRobot(ColliderSet& shapes, const ControlCurves& controls, float t)
+{
+	if (controls.value(L_SYSTEM, t))
+	{
+		poseLSystem(shapes, Mat4d(), (int)controls.value(L_SYSTEM_SIZE, t));
+		return;
+	}
+
+	int level = (int)controls.value(LEVEL_OF_DETAILS, t);
+	bool bIndividual = controls.value(INDIVIDUAL_LOOK, t) != 0;
+	Mat4d robot = robotTransform(controls, t);
+
+	poseHead(shapes, headTransform(controls, t), level);
+
+	Mat4d torso = robot * translation(-2, 6.4, -1);
+	shapes.addBox(torso, 4, 8, 2);
+	shapes.addCylinder(torso * translation(1, -1, 1) * rotation(90, 0, 1, 0), 2, 0.5, 0.5);
+
+	poseArm(shapes, robot, 1,
+		pose(controls, ROTATE_RIGHT_ARM_X, t), pose(controls, ROTATE_RIGHT_ARM_Y, t), pose(controls, ROTATE_RIGHT_ARM_Z, t),
+		pose(controls, ROTATE_RIGHT_ARM_L_X, t), pose(controls, ROTATE_RIGHT_ARM_L_Y, t), pose(controls, ROTATE_RIGHT_ARM_L_Z, t),
+		controls.value(LIFT_RIGHT_ARM, t), level, bIndividual);
+	poseArm(shapes, robot * rotation(180, 0, 1, 0), -1,
+		pose(controls, ROTATE_LEFT_ARM_X, t), pose(controls, ROTATE_LEFT_ARM_Y, t), pose(controls, ROTATE_LEFT_ARM_Z, t),
+		pose(controls, ROTATE_LEFT_ARM_L_X, t), pose(controls, ROTATE_LEFT_ARM_L_Y, t), pose(controls, ROTATE_LEFT_ARM_L_Z, t),
+		controls.value(LIFT_LEFT_ARM, t), level, bIndividual);
+
+	poseLeg(shapes, robot, 1,
+		controls.value(ROTATE_RIGHT_LEG_X, t), controls.value(ROTATE_RIGHT_LEG_Y, t), controls.value(ROTATE_RIGHT_LEG_Z, t),
+		controls.value(LIFT_RIGHT_LEG, t), level);
+	poseLeg(shapes, robot * rotation(180, 0, 1, 0), -1,
+		controls.value(ROTATE_LEFT_LEG_X, t), controls.value(ROTATE_LEFT_LEG_Y, t), controls.value(ROTATE_LEFT_LEG_Z, t),
+		controls.value(LIFT_LEFT_LEG, t), level);
+
+	// the floor
+	shapes.addBox(translation(-5, -5, -5), 10, 0.01f, 10);
+}
+
+ParticleSystem* createRobotParticleSystem()
+{
+	ParticleSystem* ps = new ParticleSystem(5, 0.1);
+
+	Emitter* mouth = new Emitter();
+	mouth->setVelocity(Vec3d(0.05, 0, -5.45), Vec3d(0.45, 0, 0.45));
+	mouth->setMass(0.2, 4.2);
+	mouth->setLifetime(5.0f);
+	mouth->setDriver([ps](Emitter& e, float t)
+	{
+		const ControlCurves& controls = ps->getControls();
+		e.setTransform(headTransform(controls, t) * translation(0.5, 1, -2));
+		e.setRate(controls.value(PARTICLE_NUM, t) * ps->getBakeFps());
+	});
+	ps->addEmitter(mouth);
+
+	// the robot and floor, posed for whatever time is simulated
+	ps->setColliderPoser([ps](ColliderSet& shapes, float t)
+	{
+		poseRobot(shapes, ps->getControls(), t);
+	});
+
+	return ps;
+}
@@ -0,0 +1,15 @@
+#ifndef ROBOT_PARTICLES_H
+#define ROBOT_PARTICLES_H
+
+class ParticleSystem;
+
+// The robot's particle system: gravity, drag and a spray out of the
+// front of its head, placed by the head controls and emitting
+// "Number of particel" particles a frame.  The controls are read off
+// the system's control curves, which the modeler copies from its
+// graphs when simulation starts and the command line baker loads
+// from a script.  The robot and floor are posed as colliders from
+// the same controls, for whatever time the system simulates.
+ParticleSystem* createRobotParticleSystem();
+
+#endif // ROBOT_PARTICLES_H
@@ -0,0 +1,120 @@
+#include "spatialGrid.h"
+#include "particle.h"
+#include "threadPool.h"
+
+#include <algorithm>
+
+// slots per work chunk handed to the thread pool
+static const int kGridGrain = 4096;
+
+SpatialGrid::SpatialGrid() :
+	m_fCellSize(1.0),
+	m_fInvCellSize(1.0),
+	m_uMask(0)
+{
+}
+
+void SpatialGrid::clear()
+{
+	m_bucket.clear();
+	m_cell.clear();
+	m_start.clear();
+	m_order.clear();
+	m_key.clear();
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+}
+
+void SpatialGrid::build(const ParticleStore& particles, double cellSize, ThreadPool& pool)
+{
+	m_fCellSize = cellSize;
+	m_fInvCellSize = 1.0 / cellSize;
+
+	int n = particles.size();
+	int nLive = particles.liveCount();
+	if (nLive == 0)
+	{
+		clear();
+		return;
+	}
+
+	// about two buckets per particle keeps most buckets to one cell
+	unsigned int uBuckets = 1024;
+	while (uBuckets < 2u * (unsigned int)nLive)
+		uBuckets <<= 1;
+	m_uMask = uBuckets - 1;
+	if (m_counts.size() != uBuckets)
+		std::vector<std::atomic<int> >(uBuckets).swap(m_counts);
+	m_start.resize(uBuckets + 1);
+	m_bucket.resize(n);
+	m_cell.resize(n);
+	m_order.resize(nLive);
+	m_key.resize(nLive);
+	m_x.resize(nLive);
+	m_y.resize(nLive);
+	m_z.resize(nLive);
+
+	pool.parallelFor((int)uBuckets, kGridGrain, [this](int begin, int end)
+	{
+		for (int b = begin; b < end; ++b)
+			m_counts[b].store(0, std::memory_order_relaxed);
+	});
+
+	// bucket of every live particle, and how many land in each bucket
+	pool.parallelFor(n, kGridGrain, [this, &particles](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (!particles.alive(i))
+			{
+				m_bucket[i] = -1;
+				continue;
+			}
+			int cx = cellOf(particles.px[i]), cy = cellOf(particles.py[i]), cz = cellOf(particles.pz[i]);
+			unsigned int b = bucketOf(cx, cy, cz);
+			m_bucket[i] = (int)b;
+			m_cell[i] = keyOf(cx, cy, cz);
+			m_counts[b].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// where each bucket starts; the counts become scatter cursors
+	int iSum = 0;
+	for (unsigned int b = 0; b < uBuckets; ++b)
+	{
+		int c = m_counts[b].load(std::memory_order_relaxed);
+		m_start[b] = iSum;
+		m_counts[b].store(iSum, std::memory_order_relaxed);
+		iSum += c;
+	}
+	m_start[uBuckets] = iSum;
+
+	pool.parallelFor(n, kGridGrain, [this](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (m_bucket[i] >= 0)
+				m_order[m_counts[m_bucket[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+		}
+	});
+
+	// the scatter order within a bucket depends on thread timing;
+	// sort it, then copy out what queries look at
+	pool.parallelFor((int)uBuckets, kGridGrain, [this, &particles](int begin, int end)
+	{
+		for (int b = begin; b < end; ++b)
+		{
+			if (m_start[b + 1] - m_start[b] > 1)
+				std::sort(m_order.begin() + m_start[b], m_order.begin() + m_start[b + 1]);
+			for (int o = m_start[b]; o < m_start[b + 1]; ++o)
+			{
+				int i = m_order[o];
+				m_key[o] = m_cell[i];
+				m_x[o] = particles.px[i];
+				m_y[o] = particles.py[i];
+				m_z[o] = particles.pz[i];
+			}
+		}
+	});
+}
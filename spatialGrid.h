@@ -0,0 +1,112 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+#include <atomic>
+#include <math.h>
+
+class ParticleStore;
+class ThreadPool;
+
+// Uniform grid over all of space, hashed into a table about twice
+// the particle count, for finding the particles near a point.
+// build() counting-sorts the live particles by bucket in parallel,
+// so each bucket's particles (with a copy of their positions) sit
+// together in memory.  Only y and z are hashed and x is added on,
+// so the three cells of a row along x land in neighbouring buckets
+// and a query scans 9 runs of memory rather than 27, skipping
+// entries of other cells that share the buckets.  Queries return
+// every particle in the 27 cells around the point, which the caller
+// still has to distance test.
+//
+// Within a bucket particles are ordered by index, so the candidate
+// order (and any sum over it) doesn't depend on the thread count.
+class SpatialGrid {
+public:
+	SpatialGrid();
+
+	// cellSize should be at least the largest query radius
+	void build(const ParticleStore& particles, double cellSize, ThreadPool& pool);
+	void clear();
+
+	double cellSize() const { return m_fCellSize; }
+	int bucketCount() const { return (int)m_start.size() - 1; }
+
+	// Calls fn(j, xj, yj, zj) for every particle j in the cells around
+	// (x, y, z), where (xj, yj, zj) is its position
+	template <class Fn>
+	void forEachCandidate(double x, double y, double z, Fn fn) const;
+
+private:
+	SpatialGrid(const SpatialGrid&);
+	SpatialGrid& operator=(const SpatialGrid&);
+
+	inline int cellOf(double x) const { return (int)floor(x * m_fInvCellSize); }
+	inline unsigned int bucketOf(int cx, int cy, int cz) const
+	{
+		return ((((unsigned int)cy * 73856093u) ^ ((unsigned int)cz * 19349663u)) + (unsigned int)cx) & m_uMask;
+	}
+	// cells within a million of the origin get distinct keys; the
+	// low 21 bits are x
+	static inline unsigned long long rowOf(int cy, int cz)
+	{
+		return ((unsigned long long)(cz & kCellMask) << 21) | (unsigned long long)(cy & kCellMask);
+	}
+	static inline unsigned long long keyOf(int cx, int cy, int cz)
+	{
+		return (rowOf(cy, cz) << 21) | (unsigned long long)(cx & kCellMask);
+	}
+
+	static const unsigned int kCellMask = 0x1fffff;
+
+	double m_fCellSize;
+	double m_fInvCellSize;
+	unsigned int m_uMask;
+
+	std::vector<int> m_bucket;				// per slot, -1 for dead ones
+	std::vector<unsigned long long> m_cell;	// per slot cell key
+	std::vector<int> m_start;				// first entry of each bucket, plus an end
+	std::vector<std::atomic<int> > m_counts;	// per bucket counts, then scatter cursors
+
+	// entries grouped by bucket: particle index, cell key, position
+	std::vector<int> m_order;
+	std::vector<unsigned long long> m_key;
+	std::vector<double> m_x, m_y, m_z;
+};
+
+template <class Fn>
+void SpatialGrid::forEachCandidate(double x, double y, double z, Fn fn) const
+{
+	if (m_order.empty())
+		return;
+
+	int cx = cellOf(x), cy = cellOf(y), cz = cellOf(z);
+	const int* start = &m_start[0];
+	const int* order = &m_order[0];
+	const unsigned long long* key = &m_key[0];
+	const double* xs = &m_x[0];
+	const double* ys = &m_y[0];
+	const double* zs = &m_z[0];
+	const unsigned int xLeft = (unsigned int)(cx - 1) & kCellMask;
+
+	for (int dz = -1; dz <= 1; ++dz)
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		unsigned long long row = rowOf(cy + dy, cz + dz);
+		unsigned int b = bucketOf(cx - 1, cy + dy, cz + dz);
+		// the row's three buckets, as one run unless they wrap around
+		int nRuns = (b + 2 <= m_uMask) ? 1 : 3;
+		for (int r = 0; r < nRuns; ++r)
+		{
+			unsigned int bFirst = (b + r) & m_uMask;
+			unsigned int bEnd = (nRuns == 1) ? b + 3 : bFirst + 1;
+			for (int o = start[bFirst]; o < start[bEnd]; ++o)
+			{
+				if ((key[o] >> 21) == row && (((unsigned int)key[o] - xLeft) & kCellMask) <= 2)
+					fn(order[o], xs[o], ys[o], zs[o]);
+			}
+		}
+	}
+}
+
+#endif // SPATIAL_GRID_H
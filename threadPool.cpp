@@ -0,0 +1,164 @@
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(int iThreadCount) :
+	m_uGeneration(0),
+	m_bStop(false),
+	m_pfnJob(NULL),
+	m_iRemaining(0)
+{
+	start(iThreadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop();
+}
+
+void ThreadPool::threadCount(int iThreadCount)
+{
+	stop();
+	start(iThreadCount);
+}
+
+void ThreadPool::start(int iThreadCount)
+{
+	if (iThreadCount <= 0)
+		iThreadCount = (int)std::thread::hardware_concurrency();
+	if (iThreadCount <= 0)
+		iThreadCount = 1;
+
+	for (int i = 0; i < iThreadCount; ++i)
+		m_queues.push_back(new Queue());
+
+	// slot 0 belongs to whichever thread calls parallelFor()
+	for (int i = 1; i < iThreadCount; ++i)
+		m_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+void ThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_wake.notify_all();
+
+	for (int i = 0; i < (int)m_threads.size(); ++i)
+		m_threads[i].join();
+	m_threads.clear();
+
+	for (int i = 0; i < (int)m_queues.size(); ++i)
+		delete m_queues[i];
+	m_queues.clear();
+
+	m_bStop = false;
+}
+
+void ThreadPool::parallelFor(int n, int iGrain, const std::function<void(int, int)>& fn)
+{
+	if (n <= 0)
+		return;
+	if (iGrain < 1)
+		iGrain = 1;
+
+	int iChunkCount = (n + iGrain - 1) / iGrain;
+
+	if (iChunkCount == 1 || m_threads.empty()) {
+		for (int begin = 0; begin < n; begin += iGrain)
+			fn(begin, (begin + iGrain < n) ? begin + iGrain : n);
+		return;
+	}
+
+	// publish the job before any chunk becomes visible to a worker
+	m_pfnJob = &fn;
+	m_iRemaining = iChunkCount;
+
+	// give every queue a contiguous run of chunks for locality
+	int iQueueCount = (int)m_queues.size();
+	for (int q = 0; q < iQueueCount; ++q) {
+		int iFirst = (int)((long long)iChunkCount * q / iQueueCount);
+		int iLast = (int)((long long)iChunkCount * (q + 1) / iQueueCount);
+
+		std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+		for (int c = iFirst; c < iLast; ++c) {
+			Chunk chunk;
+			chunk.begin = c * iGrain;
+			chunk.end = (chunk.begin + iGrain < n) ? chunk.begin + iGrain : n;
+			m_queues[q]->chunks.push_back(chunk);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_uGeneration;
+	}
+	m_wake.notify_all();
+
+	drain(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_iRemaining.load() != 0)
+		m_done.wait(lock);
+	m_pfnJob = NULL;
+}
+
+void ThreadPool::workerLoop(int iSlot)
+{
+	unsigned uSeen = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_bStop && m_uGeneration == uSeen)
+				m_wake.wait(lock);
+			if (m_bStop)
+				return;
+			uSeen = m_uGeneration;
+		}
+		drain(iSlot);
+	}
+}
+
+void ThreadPool::drain(int iSlot)
+{
+	Chunk chunk;
+
+	while (popLocal(iSlot, chunk) || steal(iSlot, chunk)) {
+		(*m_pfnJob)(chunk.begin, chunk.end);
+
+		if (--m_iRemaining == 0) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+}
+
+bool ThreadPool::popLocal(int iSlot, Chunk& chunk)
+{
+	Queue* pQueue = m_queues[iSlot];
+	std::lock_guard<std::mutex> lock(pQueue->mutex);
+
+	if (pQueue->chunks.empty())
+		return false;
+
+	chunk = pQueue->chunks.back();
+	pQueue->chunks.pop_back();
+	return true;
+}
+
+bool ThreadPool::steal(int iSlot, Chunk& chunk)
+{
+	int iQueueCount = (int)m_queues.size();
+
+	for (int k = 1; k < iQueueCount; ++k) {
+		Queue* pVictim = m_queues[(iSlot + k) % iQueueCount];
+		std::lock_guard<std::mutex> lock(pVictim->mutex);
+
+		if (!pVictim->chunks.empty()) {
+			chunk = pVictim->chunks.front();
+			pVictim->chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// A small work-stealing pool for data-parallel loops.  parallelFor()
+// cuts an index range into chunks and deals them out to one queue
+// per thread; each thread drains its own queue from the back and,
+// once empty, steals from the front of the others.  The calling
+// thread takes part in the work and the call returns only when
+// every chunk has run, so callers need no extra synchronisation.
+class ThreadPool {
+public:
+	// 0 threads means one per hardware thread
+	ThreadPool(int iThreadCount = 0);
+	~ThreadPool();
+
+	// Number of threads that run work, including the caller
+	int threadCount() const { return (int)m_queues.size(); }
+	void threadCount(int iThreadCount);
+
+	// Calls fn(begin, end) on disjoint chunks covering [0, n), each at
+	// most iGrain long.  Chunk boundaries only depend on n and iGrain,
+	// never on the thread count.
+	void parallelFor(int n, int iGrain, const std::function<void(int, int)>& fn);
+
+private:
+	struct Chunk {
+		int begin;
+		int end;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Chunk> chunks;
+	};
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void start(int iThreadCount);
+	void stop();
+	void workerLoop(int iSlot);
+	// runs chunks until none can be found; returns when out of work
+	void drain(int iSlot);
+	bool popLocal(int iSlot, Chunk& chunk);
+	bool steal(int iSlot, Chunk& chunk);
+
+	std::vector<Queue*> m_queues;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	unsigned m_uGeneration;
+	bool m_bStop;
+
+	const std::function<void(int, int)>* m_pfnJob;
+	std::atomic<int> m_iRemaining;
+};
+
+#endif // THREAD_POOL_H
@@ -4,7 +4,7 @@
 // Stupid FLTK includes iostream.h, so I can't include the official 
 // STL version of iostream.  Damn it all to bloody hell!  -- ehsu
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
 #include <iostream>
 using namespace std;
@@ -99,7 +99,7 @@ public:
 
 	//---[ Friend Methods ]----------------------
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
 	template <class U> friend U operator *( const Vec<U>& a, const Vec<U>& b );
 	template <class U> friend Vec<U> operator -( const Vec<U>& v );
@@ -208,7 +208,7 @@ public:
 
 	//---[ Friend Methods ]----------------------
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
 	template<class U> friend U operator *( const Vec3<U>& a, const Vec4<U>& b );
 	template<class U> friend U operator *( const Vec4<U>& b, const Vec3<U>& a );
@@ -328,7 +328,7 @@ public:
 	
 	//---[ Friend Methods ]----------------------
 
-#if _MSC_VER >= 1300
+#if !defined(_MSC_VER) || _MSC_VER >= 1300
 
 	template<class U> friend U operator *( const Vec3<U>& a, const Vec4<U>& b );
 	template<class U> friend U operator *( const Vec4<U>& b, const Vec3<U>& a );
@@ -557,7 +557,7 @@ Vec<T> operator-( const Vec<T>& v ) {
 	Vec<T>	result( v.numElements, false );
 
 	for( int i=0;i<v.numElements;i++ )
-		result.n[i] = -n[i];
+		result.n[i] = -v.n[i];
 
 	return result;
 }
@@ -599,7 +599,8 @@ Vec<T> operator^( const Vec<T>& a, const Vec<T>& b ) {
 		throw VectorSizeMismatch();
 #endif
 
-	return *this;
+	// there's no cross product in general dimensions; only Vec3 has one
+	return a;
 }
 
 template <class T>